@@ -8,6 +8,10 @@ C_SRCS += \
 ../gpio.c \
 ../keypad.c \
 ../lcd.c \
+../messages.c \
+../power.c \
+../protocol.c \
+../scheduler.c \
 ../timer.c \
 ../uart.c 
 
@@ -16,6 +20,10 @@ OBJS += \
 ./gpio.o \
 ./keypad.o \
 ./lcd.o \
+./messages.o \
+./power.o \
+./protocol.o \
+./scheduler.o \
 ./timer.o \
 ./uart.o 
 
@@ -24,6 +32,10 @@ C_DEPS += \
 ./gpio.d \
 ./keypad.d \
 ./lcd.d \
+./messages.d \
+./power.d \
+./protocol.d \
+./scheduler.d \
 ./timer.d \
 ./uart.d 
 
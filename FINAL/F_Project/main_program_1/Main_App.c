@@ -13,19 +13,22 @@
 #include "keypad.h"
 #include "timer.h"
 #include "uart.h"
+#include "protocol.h"
+#include "scheduler.h"
+#include "coroutine.h"
+#include "messages.h"
+#include "power.h"
+#include "gpio.h"
 #include <string.h>
+#include <avr/io.h> /* To use the SREG Register */
 
 /*******************************************************************************
  *                                Definitions                                  *
  *******************************************************************************/
 
-/* Extern the global variable in timer and UART files */
-extern Timer_ConfigType TIMER0_config;
+/* Extern the global variable in UART file */
 extern UART_ConfigType UART_config;
 
-/* global variable contain the ticks count of the timer */
-uint32 g_tick=0;
-
 /* declaring an array for the password */
 uint8 password_arr[10] = "p1";
 
@@ -40,413 +43,695 @@ uint8 error_check = 0;
 
 #define ERROR       1
 #define CLEAR       0
+#define LINK_ERROR  2
+
+/* number of digits in the password */
+#define PASSWORD_LENGTH           5
+
+/* number of wrong passwords in row that fires the buzzer */
+#define MAX_WRONG_PASSWORDS       3
+
+/* MC2 reply deadlines: PROCESSING is shown only if the reply is late, no reply at all is a link error */
+#define RESPONSE_PROCESSING_MS                  250
+#define RESPONSE_TIMEOUT_MS                     3000
+
+/* Messages & door cycle durations */
+#define NOT_CONFIRMED_MESSAGE_MS                5000
+#define RESULT_MESSAGE_MS                       2000
+#define BUZZER_MESSAGE_MS                       10000
+#define SERVICE_MESSAGE_MS                      5000
+
+/* Nominal door cycle (timings shared with MC2 in protocol.h), the progress bar is estimated on
+   it but the door screen ends only when MC2 reports the door closed, or stopped in its fault */
+#define DOOR_CYCLE_MS                           (DOOR_MOVING_MS + DOOR_HOLD_MS + DOOR_MOVING_MS)
+
+/* Period the door state is asked to MC2 at, and the door screen timeout if MC2 never reports
+   the end of the cycle */
+#define DOOR_STATUS_POLL_MS                     500
+#define DOOR_SCREEN_TIMEOUT_MS                  (2 * DOOR_CYCLE_MS)
+
+/* The progress bars of the buzzer & the door take their durations as uint16 values */
+#if (BUZZER_MESSAGE_MS > 0xFFFFUL) || (DOOR_CYCLE_MS > 0xFFFFUL)
+#error "BUZZER_MESSAGE_MS & DOOR_CYCLE_MS must be at most 65535 ms for the progress bars"
+#endif
+
+/* Software timers ids */
+#define KEYPAD_TIMER_ID                         0
 
-/* define timer constants */
-#define NUMBER_OF_OVERFLOWS_PER_SECOND          500
-#define NUMBER_OF_OVERFLOWS_PER_MILLI_SECOND    5
+/* Period the keypad events are taken & the HMI flows are resumed at */
+#define KEYPAD_POLL_MS                          20
 
+/* Set to 1 to drive the probe pin high while the tick ISR works, the width of its pulses on a
+   scope is the ISR time which must stay well below the 1 ms tick */
+#define TICK_PROBE                              0
+#define TICK_PROBE_PORT_ID                      PORTA_ID
+#define TICK_PROBE_PIN_ID                       PIN3_ID
 
-/* shared Commands between MC1 & MC2 */
-#define CORRECT_PASSWORD          (0x01)
-#define WRONG_PASSWORD            (0x02)
-#define OPEN_DOOR                 (0x03)
-#define FIRE_BUZZER               (0x04)
-#define CHANGE_PASSWORD           (0x05)
-#define CHECK_PASSWORD            (0x06)
+/* Events dispatched by the main loop */
+#define EVENT_KEYPAD_POLL                       0
+#define EVENT_KEY_PRESSED                       1 /* the parameter is the pressed key */
+
+/* Number of keys typed ahead that wait for the HMI flows, must be a power of 2 */
+#define TYPE_AHEAD_SIZE                         8
+#define TYPE_AHEAD_MASK                         (TYPE_AHEAD_SIZE - 1)
+
+#if ((TYPE_AHEAD_SIZE & TYPE_AHEAD_MASK) != 0)
+#error "TYPE_AHEAD_SIZE must be a power of 2"
+#endif
+
+/* What the screen shown now does with the keys pressed while it is shown */
+typedef enum
+{
+	KEY_KEEP,     /* the keys are kept for the next screen that waits for keys */
+	KEY_DISCARD,  /* the keys typed ahead & pressed during the screen are dropped */
+	KEY_SKIP      /* a key ends the message & is kept for the next screen */
+}KEY_PolicyType;
+
+/* key taken by the last WAIT_KEY */
+uint8 pressed_key = KEYPAD_NO_KEY;
+
+/* Keys typed ahead, they are put & taken in the main loop only */
+uint8 type_ahead[TYPE_AHEAD_SIZE];
+uint8 type_ahead_head = 0;
+uint8 type_ahead_tail = 0;
+
+/* Policy of the screen shown now */
+KEY_PolicyType key_policy = KEY_KEEP;
+
+/* status & result of the last command waited by WAIT_RESULT */
+PROTOCOL_StatusType reply_status;
+uint8 reply_result;
+
+/* context of the HMI flow run by the main loop */
+CO_ContextType hmi_context;
+
+/* TRUE while the HMI flow has nothing to do but wait for a key, so the keypad polling can be
+   stopped while the keypad is in standby */
+boolean hmi_waits_key = FALSE;
+
+/* Wait in a flow for the next key in pressed_key, the keys typed ahead are taken first */
+#define WAIT_KEY(ctx)                                                     \
+	do {                                                                  \
+		hmi_waits_key = TRUE;                                             \
+		CO_WAIT_UNTIL(ctx,TYPE_AHEAD_GET(&pressed_key));                  \
+		hmi_waits_key = FALSE;                                            \
+	} while(0)
+
+/* Show the message on the LCD for the given milli-seconds with the given key policy, a key
+   ends it early with KEY_SKIP, "deadline" must be a static uint32 */
+#define SHOW_MESSAGE(ctx,deadline,m_seconds,policy)                       \
+	do {                                                                  \
+		SET_KEY_POLICY(policy);                                           \
+		(deadline) = Timer_deadline(m_seconds);                           \
+		CO_WAIT_UNTIL(ctx,Timer_isExpired(deadline) ||                    \
+			((key_policy == KEY_SKIP) && (type_ahead_head != type_ahead_tail))); \
+		SET_KEY_POLICY(KEY_KEEP);                                         \
+	} while(0)
 
-/* Shared condition to make sure that MC2 is ready to receive new data */
-#define MC2_READY                 (0x10)
 /*******************************************************************************
  *                      Functions Definitions                                  *
  *******************************************************************************/
 
 /*
  * Description :
- * Call-back function that is called to be done when the timer interrupt occurs
+ * Put a pressed key in the type ahead buffer, it is dropped if the buffer is full
  */
-void _TIMER0_CALLBACK(void)
+void TYPE_AHEAD_PUT(uint8 key)
 {
-	/* incrementing the number of ticks whenever the timer interrupt happens */
-	g_tick++;
-}
+	uint8 next_head = (type_ahead_head + 1) & TYPE_AHEAD_MASK;
 
+	if(next_head != type_ahead_tail)
+	{
+		type_ahead[type_ahead_head] = key;
+		type_ahead_head = next_head;
+	}
+}
 
 /*
  * Description :
- * Delay Function that works to make specific delays based on the user choice
+ * Take the oldest key typed ahead in "key", returns FALSE if no key is waiting
  */
-void _delay_second(uint8 seconds)
+boolean TYPE_AHEAD_GET(uint8 *key)
 {
-	/*Setting up the configuration object for the timer */
-	TIMER0_config.clock = F_CPU_8;
-	TIMER0_config.compare_value = 0;
-	TIMER0_config.initial_value = 0;
-	TIMER0_config.mode = NORMAL;
-
-	/* Setting up & initializing the timer before starting up */
-	 Timer0_setCallBack(_TIMER0_CALLBACK);
-	 Timer0_Init(&TIMER0_config);
-
-	 /* while loop to hold on the processor until the required delay time occures */
-	 while (g_tick <(seconds * NUMBER_OF_OVERFLOWS_PER_SECOND));
-	 g_tick=0;
-
-	 /* Closing the timer after using it */
-	 Timer_DeInit();
+	if(type_ahead_tail == type_ahead_head)
+	{
+		return FALSE;
+	}
+	*key = type_ahead[type_ahead_tail];
+	type_ahead_tail = (type_ahead_tail + 1) & TYPE_AHEAD_MASK;
+
+	return TRUE;
 }
 
 /*
  * Description :
- * Delay Function that works to make specific delays based on the user choice
+ * Set the key policy of the screen shown now, KEY_DISCARD also drops the keys typed ahead
  */
-void _delay_milli_second(uint32 m_seconds)
+void SET_KEY_POLICY(KEY_PolicyType policy)
 {
-	/*Setting up the configuration object for the timer */
-	TIMER0_config.clock = F_CPU_8;
-	TIMER0_config.compare_value = 0;
-	TIMER0_config.initial_value = 0;
-	TIMER0_config.mode = NORMAL;
-
-	/* Setting up & initializing the timer before starting up */
-	 Timer0_setCallBack(_TIMER0_CALLBACK);
-	 Timer0_Init(&TIMER0_config);
-
-	 /* while loop to hold on the processor until the required delay time occurs */
-	 while (g_tick <(m_seconds * NUMBER_OF_OVERFLOWS_PER_MILLI_SECOND));
-	 g_tick=0;
-
-	 /* Closing the timer after using it */
-	 Timer_DeInit();
+	if(policy == KEY_DISCARD)
+	{
+		type_ahead_tail = type_ahead_head;
+	}
+	key_policy = policy;
 }
 
+/*
+ * Description :
+ * Return the milli-seconds left before the deadline (at most 65535), 0 if it has expired
+ */
+uint16 TIME_LEFT(uint32 deadline)
+{
+	uint32 time_left = deadline - Timer_millis();
+
+	if((sint32)time_left <= 0)
+	{
+		return 0;
+	}
+	return (time_left > 0xFFFF) ? 0xFFFF : (uint16)time_left;
+}
 
 /*
  * Description :
- * Function to read the password and confirm it:
- * 1. takes the password from the user and confirms it
- * 2. if the password is correct, it changes error_check variable to zero
- * 3. if the password has been entered wrong for 3 times in row, the buzzer is fired & changes
- *    error_check variable to one
+ * Flow that waits for the ACK/NAK of a command sent to MC2, its status & result are stored
+ * in reply_status & reply_result:
+ * 1. it is done as soon as the reply is received with the result it carries
+ * 2. shows PROCESSING only if the reply is late
+ * 3. gives up with PROTOCOL_TIMEOUT if MC2 does not reply before the deadline
  */
+CO_StatusType WAIT_RESULT(CO_ContextType *ctx, uint8 seq)
+{
+	static boolean processing_shown;
+	static uint32 processing_deadline;
+	static uint32 timeout_deadline;
 
-void Read_Password(void)
+	CO_BEGIN(ctx);
+
+	/* Setting up the deadlines on the system tick */
+	processing_shown = FALSE;
+	processing_deadline = Timer_deadline(RESPONSE_PROCESSING_MS);
+	timeout_deadline = Timer_deadline(RESPONSE_TIMEOUT_MS);
+
+	/* wait for the reply of MC2 or its deadline */
+	while((reply_status = PROTOCOL_getResult(seq,&reply_result)) == PROTOCOL_PENDING)
+	{
+		if(Timer_isExpired(timeout_deadline))
+		{
+			/* MC2 is not responding, stop waiting for this command */
+			PROTOCOL_cancel(seq);
+			reply_status = PROTOCOL_TIMEOUT;
+			break;
+		}
+		else if((processing_shown == FALSE) && Timer_isExpired(processing_deadline))
+		{
+			MESSAGES_display(0,3,MSG_PROCESSING);
+			processing_shown = TRUE;
+		}
+		CO_YIELD(ctx);
+	}
+
+	CO_END(ctx);
+}
+
+
+/*
+ * Description :
+ * Flow that takes PASSWORD_LENGTH keys from the user in the given array, showing '*' for
+ * every key, and terminates it by NULL so it can be compared
+ */
+CO_StatusType READ_DIGITS(CO_ContextType *ctx, uint8 *password)
 {
 	/* Variable to be used in the for loop */
-	uint8 i;
+	static uint8 i;
 
-	/* declaring a variable for password state */
-	uint8 password_State;
+	CO_BEGIN(ctx);
 
-	/* declaring a variable for error numbers */
-	uint8 error_count = 0;
+	for(i=0; i<PASSWORD_LENGTH; i++)
+	{
+		WAIT_KEY(ctx);
+		password[i] = pressed_key;
+		LCD_displayCharacter('*');
+	}
+	password[PASSWORD_LENGTH] = '\0';
 
-	/* Initializing the two password arrays before taking inputs from user */
-	strcpy(password_arr,"p1");
-	strcpy(password_confirm_arr,"p2");
+	CO_END(ctx);
+}
 
-	LCD_clearScreen();
 
+/*
+ * Description :
+ * Flow that takes a password from the user and confirms it in password_arr, it asks again
+ * until the two entered passwords match
+ */
+CO_StatusType ENTER_PASSWORD(CO_ContextType *ctx, MESSAGES_IdType line1, MESSAGES_IdType line2)
+{
+	static CO_ContextType child;
+	static uint32 deadline;
+
+	CO_BEGIN(ctx);
 
+	/* Initializing the two password arrays before taking inputs from user */
+	strcpy(password_arr,"p1");
+	strcpy(password_confirm_arr,"p2");
 
 	/* While loop to confirm that the input password is correctly taken from the user */
-	while(error_count < 3)
+	while(strcmp(password_arr,password_confirm_arr) != 0)
 	{
-
-		while(strcmp(password_arr,password_confirm_arr) != 0)
+		/* checks if this is the first time the program enters this loop or not */
+		if(confirm_check != 0)
 		{
+			MESSAGES_display(0,0,MSG_PASSWORD_NOT);
+			MESSAGES_display(1,0,MSG_CONFIRMED);
+			MESSAGES_display(2,0,MSG_PLEASE_RE_ENTER);
+			MESSAGES_display(3,0,MSG_YOUR_PASSWORD);
 
-			/* checks if this is the first time the program enters this loop or not */
-			if(confirm_check != 0)
-			{
-				LCD_displayStringRowColumn(0,0,"Password not");
-				LCD_displayStringRowColumn(1,0,"Confirmed");
-				LCD_displayStringRowColumn(2,0,"Please re-enter");
-				LCD_displayStringRowColumn(3,0,"your password !");
+			/* wait for 5 seconds until the user reads the message, or until the user starts
+			   typing the password again */
+			SHOW_MESSAGE(ctx,deadline,NOT_CONFIRMED_MESSAGE_MS,KEY_SKIP);
 
-				/* delay for 5 seconds until the user reads the message */
-				_delay_second(5);
+			LCD_clearScreen();
+		}
 
-				LCD_clearScreen();
-			}
+		/*Takes the password from the user */
+		MESSAGES_display(1,0,line1);
+		MESSAGES_display(2,0,line2);
+		LCD_moveCursor(3,6);
+		CO_SPAWN(ctx,&child,READ_DIGITS(&child,password_arr));
 
-			/*Takes the password from the user and send it to MC2 */
-			LCD_displayStringRowColumn(1,0,"Enter Your");
-			LCD_displayStringRowColumn(2,0,"Password !");
-			LCD_moveCursor(3,6);
+		LCD_clearScreen();
 
-			/* A Loop to take the input password from the user */
-			for(i=0; i<5; i++)
-			{
-				password_arr[i] =  KEYPAD_getPressedKey();
-				LCD_displayCharacter('*');
+		/*confirming the password entered from the user*/
+		MESSAGES_display(1,0,MSG_PLEASE_CONFIRM);
+		MESSAGES_display(2,0,MSG_YOUR_PASSWORD);
+		LCD_moveCursor(3,6);
+		CO_SPAWN(ctx,&child,READ_DIGITS(&child,password_confirm_arr));
 
-				/* delay for 500 milli second until the button is released */
-				_delay_milli_second(50);
-			}
-			/* Inserting '#' at the end of the password so that the MC2 Stops on reading it */
-			password_arr[5] = '#';
-			/* Inserting the null '\0' at the end of the password so that the MC1
-		       stops on sending it */
-			password_arr[6] = '\0';
+		LCD_clearScreen();
 
-			LCD_clearScreen();
+		/* changing the value of the confirm_check variable to recognize that the loop has
+		   been entered  */
+		confirm_check = 1;
+	}
 
-			/*confirming the password entered from the user*/
-			LCD_displayStringRowColumn(1,0,"Please Confirm");
-			LCD_displayStringRowColumn(2,0,"your password !");
-			LCD_moveCursor(3,6);
+	/* re-set the value of confirm_check variable */
+	confirm_check = 0;
 
-			/* A Loop to take the input password from the user */
-			for(i=0; i<5; i++)
-			{
-				password_confirm_arr[i] =  KEYPAD_getPressedKey();
-				LCD_displayCharacter('*');
+	CO_END(ctx);
+}
 
 
-				/* delay for 500 milli second until the button is released */
-				_delay_milli_second(50);
-			}
-			/* Inserting '#' at the end of the password so that the MC2 Stops on reading it */
-			password_confirm_arr[5] = '#';
-			/* Inserting the null '\0' at the end of the password so that the MC1
-		       stops on sending it */
-			password_confirm_arr[6] = '\0';
+/*
+ * Description :
+ * Flow to read the password and confirm it:
+ * 1. takes the password from the user and confirms it
+ * 2. sends it to MC2 with the required check command (CHECK_PASSWORD or VERIFY_AND_OPEN)
+ * 3. if the password is correct, it changes error_check variable to zero
+ * 4. if the password has been entered wrong for 3 times in row, the buzzer is fired & changes
+ *    error_check variable to one
+ * 5. if MC2 does not reply, or rejects the request or its result is lost, an error is shown &
+ *    error_check variable changes to LINK_ERROR
+ */
+CO_StatusType Read_Password(CO_ContextType *ctx, uint8 check_command)
+{
+	static CO_ContextType child;
+	static uint8 seq;
+	static uint32 deadline;
 
-			LCD_clearScreen();
+	/* declaring a variable for error numbers */
+	static uint8 error_count;
 
-			/* changing the value of the confirm_check variable to recognize that the loop has
-			   been entered  */
-			confirm_check = 1;
-		}
+	/* milli-seconds left of the buzzer, it is not kept across the waits */
+	uint16 time_left;
 
-		/* re-set the value of confirm_check variable */
-		confirm_check = 0;
+	CO_BEGIN(ctx);
 
-		/* Wait until MC2 is ready*/
-		while(UART_recieveByte() != MC2_READY){}
+	error_count = 0;
 
-		/*Request for password check */
-		UART_sendByte(CHECK_PASSWORD);
+	while(error_count < MAX_WRONG_PASSWORDS)
+	{
+		CO_SPAWN(ctx,&child,ENTER_PASSWORD(&child,MSG_ENTER_YOUR,MSG_PASSWORD));
 
-		/* Wait until MC2 is ready*/
-		while(UART_recieveByte() != MC2_READY){}
+		/*Request for password check with the confirmed password in the same frame, the state
+		  of the password is carried by the ACK of the check command */
+		seq = PROTOCOL_sendCommand(check_command,password_arr,PASSWORD_LENGTH);
+		CO_SPAWN(ctx,&child,WAIT_RESULT(&child,seq));
 
-		/*sending the confirmed password for MC2 */
-		UART_sendString(password_arr);
+		if(reply_status == PROTOCOL_TIMEOUT)
+		{
+			LCD_clearScreen();
+			MESSAGES_display(0,0,MSG_MC2_IS_NOT);
+			MESSAGES_display(1,0,MSG_RESPONDING);
+			SHOW_MESSAGE(ctx,deadline,RESULT_MESSAGE_MS,KEY_DISCARD);
+			LCD_clearScreen();
 
-		LCD_displayStringRowColumn(0,3,"PROCESSING");
+			error_check = LINK_ERROR;
+			CO_EXIT(ctx);
+		}
+		else if((reply_status != PROTOCOL_ACKED) ||
+				((reply_result != CORRECT_PASSWORD) && (reply_result != WRONG_PASSWORD)))
+		{
+			/* NAKed, expired or an unexpected result: the state of the password is unknown */
+			LCD_clearScreen();
+			MESSAGES_display(0,0,MSG_REQUEST_REJECTED);
+			MESSAGES_display(1,0,MSG_BY_MC2);
+			SHOW_MESSAGE(ctx,deadline,RESULT_MESSAGE_MS,KEY_DISCARD);
+			LCD_clearScreen();
 
-		/* wait 2 seconds until MC2 checks on the password */
-		_delay_second(2);
+			error_check = LINK_ERROR;
+			CO_EXIT(ctx);
+		}
 		LCD_clearScreen();
 
-		/* Checks about the condition of the password */
-		password_State = UART_recieveByte();
-		if(password_State == CORRECT_PASSWORD)
+		if(reply_result == CORRECT_PASSWORD)
 		{
-			LCD_displayStringRowColumn(0,0,"Correct Password");
-			_delay_second(2);
+			MESSAGES_display(0,0,MSG_CORRECT_PASSWORD);
+			SHOW_MESSAGE(ctx,deadline,RESULT_MESSAGE_MS,KEY_SKIP);
 
 			error_check = CLEAR;
-			return;
+			CO_EXIT(ctx);
 		}
-		else if(password_State == WRONG_PASSWORD)
+		else if(reply_result == WRONG_PASSWORD)
 		{
-			LCD_displayStringRowColumn(0,0,"Wrong Password");
-			_delay_second(2);
+			MESSAGES_display(0,0,MSG_WRONG_PASSWORD);
+			SHOW_MESSAGE(ctx,deadline,RESULT_MESSAGE_MS,KEY_SKIP);
 
 			error_check = ERROR;
 			error_count ++;
 		}
 
 		LCD_clearScreen();
-
-		/* initializing the two arrays again so we can enter the read password loop again */
-		strcpy(password_arr,"p1");
-		strcpy(password_confirm_arr,"p2");
 	}
 
-	/* Wait until MC2 is ready*/
-	while(UART_recieveByte() != MC2_READY){}
-
 	/* IF it ever gets outside while loop, it means that password is entered wrong 3
-	 * times in row, so we fire buzzer */
-	UART_sendByte(FIRE_BUZZER);
-
-	/*Buzzer is fired for seconds */
-	LCD_displayStringRowColumn(0,0,"WRONG PASSWORD");
-	LCD_displayStringRowColumn(1,0,"BUZZER ON");
-
-	_delay_second(10);
+	 * times in row, so we fire buzzer and wait for the ACK so the credit is returned even
+	 * if MC2 is not responding */
+	seq = PROTOCOL_sendCommand(FIRE_BUZZER,NULL_PTR,0);
+	CO_SPAWN(ctx,&child,WAIT_RESULT(&child,seq));
+
+	/*Buzzer is fired for seconds, the seconds left are counted down with a progress bar, the
+	  keys pressed meanwhile are not taken */
+	MESSAGES_display(0,0,MSG_WRONG_PASSWORD_ALARM);
+	MESSAGES_display(1,0,MSG_BUZZER_ON);
+	SET_KEY_POLICY(KEY_DISCARD);
+
+	deadline = Timer_deadline(BUZZER_MESSAGE_MS);
+	while(Timer_isExpired(deadline) == FALSE)
+	{
+		time_left = TIME_LEFT(deadline);
+		LCD_moveCursor(2,0);
+		LCD_printf_P(MESSAGES_get(MSG_SECONDS_LEFT),(time_left + 999) / 1000);
+		LCD_displayProgressBar(3,0,LCD_COLS,time_left,(uint16)BUZZER_MESSAGE_MS);
+		CO_YIELD(ctx);
+	}
+	SET_KEY_POLICY(KEY_KEEP);
 
 	LCD_clearScreen();
-	return ;
+
+	CO_END(ctx);
 }
 
 
 /*
  * Description :
- * Function to handle all operations done in the open door choice:
- * 1. if the password is correct it, it opens the opens the door
- * 2. if the password has been entered wrong
+ * Flow to handle all operations done in the open door choice:
+ * 1. the password is sent with VERIFY_AND_OPEN so MC2 opens the door as soon as it is correct
+ * 2. if the password has been entered wrong, the door is not opened
  */
-
-void DOOR_CHOICE(void)
+CO_StatusType DOOR_CHOICE(CO_ContextType *ctx)
 {
+	static CO_ContextType child;
+	static uint32 start;
+	static uint32 poll_deadline;
+	static uint32 timeout_deadline;
+	static uint8 seq;
+	static uint8 door_state;
+	static uint32 elapsed;
+
+	CO_BEGIN(ctx);
 
 	LCD_clearScreen();
 
-	/* call the Read_Password function to test the password */
-	Read_Password();
+	/* test the password & open the door in one request */
+	CO_SPAWN(ctx,&child,Read_Password(&child,VERIFY_AND_OPEN));
 
 	/* Now checking on the error_check variable */
 	if(error_check == CLEAR)
 	{
 		LCD_clearScreen();
 
+		MESSAGES_display(0,0,MSG_OPENING_THE);
+		MESSAGES_display(1,0,MSG_DOOR);
+
+		/* wait until MC2 reports the door closed again, asking for its state every
+		   DOOR_STATUS_POLL_MS & showing the progress of the door cycle on the last row, the
+		   keys pressed meanwhile are not taken */
+		SET_KEY_POLICY(KEY_DISCARD);
+		start = Timer_millis();
+		timeout_deadline = Timer_deadline(DOOR_SCREEN_TIMEOUT_MS);
+		door_state = DOOR_STATE_OPENING;
+		while((door_state != DOOR_STATE_CLOSED) && (door_state != DOOR_STATE_FAULT) &&
+				(Timer_isExpired(timeout_deadline) == FALSE))
+		{
+			seq = PROTOCOL_sendCommand(DOOR_STATUS,NULL_PTR,0);
+			poll_deadline = Timer_deadline(DOOR_STATUS_POLL_MS);
+			while(Timer_isExpired(poll_deadline) == FALSE)
+			{
+				/* the bar stays short of full until the door is really closed */
+				elapsed = Timer_millis() - start;
+				if(elapsed >= DOOR_CYCLE_MS)
+				{
+					elapsed = DOOR_CYCLE_MS - 1;
+				}
+				LCD_displayProgressBar(3,0,LCD_COLS,(uint16)elapsed,(uint16)DOOR_CYCLE_MS);
+				CO_YIELD(ctx);
+			}
 
-		/* Wait until MC2 is ready*/
-		while(UART_recieveByte() != MC2_READY){}
-
-		UART_sendByte(OPEN_DOOR);
-
-		LCD_displayStringRowColumn(0,0,"Opening the");
-		LCD_displayStringRowColumn(1,0,"Door");
-
-		/* wait for 15 seconds until the door is opened */
-		_delay_second(15);
-
-		/* Keep the door open for 3 seconds */
-		_delay_second(3);
-
-		/* wait for 15 seconds until the door closed */
-		_delay_second(15);
+			/* a late reply is not waited for, the next poll asks again */
+			if(PROTOCOL_getResult(seq,&reply_result) == PROTOCOL_ACKED)
+			{
+				door_state = reply_result;
+			}
+			else
+			{
+				PROTOCOL_cancel(seq);
+			}
+		}
+		LCD_displayProgressBar(3,0,LCD_COLS,(uint16)DOOR_CYCLE_MS,(uint16)DOOR_CYCLE_MS);
+		SET_KEY_POLICY(KEY_KEEP);
 	}
 
 	LCD_clearScreen();
-	return;
+
+	CO_END(ctx);
 }
 
 
 /*
  * Description :
- * Function to handle all operations done in the change password choice:
+ * Flow to handle all operations done in the change password choice:
  * 1. if the password is correct it, password is taken from the user to be changed
  * 2. if the password has been entered wrong, it returns to the main menu
  */
-void CHANGE_PASSWORD_CHOICE(void)
+CO_StatusType CHANGE_PASSWORD_CHOICE(CO_ContextType *ctx)
 {
-	/* Variable to be used in the for loop */
-	uint8 i;
+	static CO_ContextType child;
+	static uint8 seq;
+	static uint32 deadline;
 
-	LCD_clearScreen();
-
-	/* Initializing the two password arrays before taking inputs from user */
-	strcpy(password_arr,"p1");
-	strcpy(password_confirm_arr,"p2");
+	CO_BEGIN(ctx);
 
-	/* call the Read_Password function to test the password */
-	Read_Password();
+	LCD_clearScreen();
 
-
-	/* Initializing the two password arrays before taking inputs from user */
-	strcpy(password_arr,"p1");
-	strcpy(password_confirm_arr,"p2");
+	/* test the password */
+	CO_SPAWN(ctx,&child,Read_Password(&child,CHECK_PASSWORD));
 
 	/* Now checking on the error_check variable */
 	if(error_check == CLEAR)
 	{
 		/* Now taking the new password to be changed */
 		LCD_clearScreen();
+		CO_SPAWN(ctx,&child,ENTER_PASSWORD(&child,MSG_ENTER_YOUR,MSG_NEW_PASSWORD));
+
+		/* Send the the change password command with the new confirmed password for MC2 */
+		seq = PROTOCOL_sendCommand(CHANGE_PASSWORD,password_arr,PASSWORD_LENGTH);
+		CO_SPAWN(ctx,&child,WAIT_RESULT(&child,seq));
 
-		/* While loop to confirm that the input password is correctly taken from the user */
-		while(strcmp(password_arr,password_confirm_arr) != 0)
+		if(reply_status != PROTOCOL_ACKED)
 		{
+			LCD_clearScreen();
+			MESSAGES_display(0,0,MSG_PASSWORD_NOT);
+			MESSAGES_display(1,0,MSG_CHANGED);
+			SHOW_MESSAGE(ctx,deadline,RESULT_MESSAGE_MS,KEY_SKIP);
+		}
+	}
 
-			/* checks if this is the first time the program enters this loop or not */
-			if(confirm_check != 0)
-			{
-				LCD_displayStringRowColumn(0,0,"Password not");
-				LCD_displayStringRowColumn(1,0,"Confirmed");
-				LCD_displayStringRowColumn(2,0,"Please re-enter");
-				LCD_displayStringRowColumn(3,0,"your password !");
+	CO_END(ctx);
+}
 
-				/* delay for 5 seconds until the user reads the message */
-				_delay_second(5);
 
-				LCD_clearScreen();
-			}
+/*
+ * Description :
+ * Service screen of the power statistics, it is opened by the '=' key in the main menu (it is
+ * not shown in the menu) & shows the average current, the wake ups from standby & the latency
+ * of the last one, a key ends it early
+ */
+CO_StatusType POWER_CHOICE(CO_ContextType *ctx)
+{
+	static uint32 deadline;
+	POWER_StatsType stats;
 
-			/*Takes the password from the user and send it to MC2 */
-			LCD_displayStringRowColumn(1,0,"Enter Your");
-			LCD_displayStringRowColumn(2,0,"New Password !");
-			LCD_moveCursor(3,6);
+	CO_BEGIN(ctx);
 
-			/* A Loop to take the input password from the user */
-			for(i=0; i<5; i++)
-			{
-				password_arr[i] =  KEYPAD_getPressedKey();
-				LCD_displayCharacter('*');
+	POWER_getStats(&stats);
+	LCD_clearScreen();
+	MESSAGES_display(0,0,MSG_POWER_STATISTICS);
+	LCD_moveCursor(1,0);
+	LCD_printf_P(MESSAGES_get(MSG_AVERAGE_CURRENT),stats.average_current_ua);
+	LCD_moveCursor(2,0);
+	LCD_printf_P(MESSAGES_get(MSG_WAKE_UPS),stats.wakeups);
+	LCD_moveCursor(3,0);
+	LCD_printf_P(MESSAGES_get(MSG_WAKE_LATENCY),stats.wake_latency_ms);
+	SHOW_MESSAGE(ctx,deadline,SERVICE_MESSAGE_MS,KEY_SKIP);
+
+	CO_END(ctx);
+}
 
 
-				/* delay for 500 milli second until the button is released */
-				_delay_milli_second(50);
-			}
-			/* Inserting '#' at the end of the password so that the MC2 Stops on reading it */
-			password_arr[5] = '#';
-			/* Inserting the null '\0' at the end of the password so that the MC1
-		       stops on sending it */
-			password_arr[6] = '\0';
+/*
+ * Description :
+ * The HMI flow, it never ends:
+ * 1. Takes the password from the user for the first time and sends it to MC2
+ * 2. Menu shows on the LCD to choose between opening the door or changing the password
+ * 3. if it's required to change the password, the existing password is required twice then
+ *    you can change the password
+ * 4. if it's required to open the door, the existing password is required twice then the
+ *    the door is opened
+ * 5. if the wring password entered for 3 times in row, buzzer is fired for 10 seconds
+ * 6. the '=' key in the menu shows the power statistics service screen
+ */
+CO_StatusType HMI_FLOW(CO_ContextType *ctx)
+{
+	static CO_ContextType child;
+	static uint8 seq;
 
-			LCD_clearScreen();
+	CO_BEGIN(ctx);
 
-			/*confirming the password entered from the user*/
-			LCD_displayStringRowColumn(1,0,"Please Confirm");
-			LCD_displayStringRowColumn(2,0,"your password !");
-			LCD_moveCursor(3,6);
+	/* Takes the first password from the user */
+	CO_SPAWN(ctx,&child,ENTER_PASSWORD(&child,MSG_ENTER_PASSWORD,MSG_OF_5_NUMBERS));
 
-			/* A Loop to take the input password from the user */
-			for(i=0; i<5; i++)
-			{
-				password_confirm_arr[i] =  KEYPAD_getPressedKey();
-				LCD_displayCharacter('*');
+	/*sending the confirmed password for MC2 to be stored as the first password, it is sent
+	  again until MC2 acknowledges it as MC2 may still be starting up */
+	do
+	{
+		seq = PROTOCOL_sendCommand(CHANGE_PASSWORD,password_arr,PASSWORD_LENGTH);
+		CO_SPAWN(ctx,&child,WAIT_RESULT(&child,seq));
+	}while(reply_status != PROTOCOL_ACKED);
+	LCD_clearScreen();
 
+	while(1)
+	{
+		/* Showing the menu to choose between opening the door or changing the password */
+		MESSAGES_display(1,0,MSG_MENU_OPEN_DOOR);
+		MESSAGES_display(2,0,MSG_MENU_CHANGE_THE);
+		MESSAGES_display(3,3,MSG_MENU_PASSWORD);
 
-				/* delay for 500 milli second until the button is released */
-				_delay_milli_second(50);
-			}
-			/* Inserting '#' at the end of the password so that the MC2 Stops on reading it */
-			password_confirm_arr[5] = '#';
-			/* Inserting the null '\0' at the end of the password so that the MC1
-		       stops on sending it */
-			password_confirm_arr[6] = '\0';
+		/* taking the choice from the user*/
+		WAIT_KEY(ctx);
 
+		if(pressed_key == '+')
+		{
+			CO_SPAWN(ctx,&child,DOOR_CHOICE(&child));
+			LCD_clearScreen();
+		}
+		else if(pressed_key == '-')
+		{
+			CO_SPAWN(ctx,&child,CHANGE_PASSWORD_CHOICE(&child));
+			LCD_clearScreen();
+		}
+		else if(pressed_key == '=')
+		{
+			CO_SPAWN(ctx,&child,POWER_CHOICE(&child));
 			LCD_clearScreen();
-
-			/* changing the value of the confirm_check variable to recognize that the loop has
-			   been entered  */
-			confirm_check = 1;
 		}
+	}
+
+	CO_END(ctx);
+}
+
+/*
+ * Description :
+ * Call Back function of the system tick, it drains the LCD writes queue, scans the keypad &
+ * puts it in standby when nobody is at the door in the timer ISR
+ */
+void TICK_CALLBACK(void)
+{
+#if TICK_PROBE
+	GPIO_FAST_SET_PIN(TICK_PROBE_PORT_ID,TICK_PROBE_PIN_ID);
+#endif
+	LCD_processQueue();
+	KEYPAD_tick();
+	POWER_tick();
+#if TICK_PROBE
+	GPIO_FAST_CLEAR_PIN(TICK_PROBE_PORT_ID,TICK_PROBE_PIN_ID);
+#endif
+}
 
-		/* re-set the value of confirm_check variable */
-		confirm_check = 0;
+/*
+ * Description :
+ * Call Back function of the keypad timer, it runs in the timer ISR so it only posts the
+ * keypad poll event to the main loop
+ */
+void KEYPAD_POLL_CALLBACK(void)
+{
+	SCHEDULER_postEvent(EVENT_KEYPAD_POLL,0);
+}
 
-		/* Wait until MC2 is ready*/
-		while(UART_recieveByte() != MC2_READY){}
+/*
+ * Description :
+ * Handler of the keypad poll event, posts a key event for every key press debounced by the
+ * tick ISR, resumes the HMI flow so its deadlines & MC2 replies are checked, sends the cells
+ * it changed to the LCD and re-arms the keypad timer
+ */
+void KEYPAD_POLL(uint8 param)
+{
+	KEYPAD_EventType event;
 
-		/* Send the the change password command for MC2 */
-		UART_sendByte(CHANGE_PASSWORD);
+	while(KEYPAD_getEvent(&event) == TRUE)
+	{
+		if(event.kind == KEYPAD_PRESSED)
+		{
+			SCHEDULER_postEvent(EVENT_KEY_PRESSED,event.key);
+		}
+	}
 
-		/* Wait until MC2 is ready*/
-		while(UART_recieveByte() != MC2_READY){}
+	HMI_FLOW(&hmi_context);
+	LCD_flush();
 
-		/*sending the new confirmed password for MC2 */
-		UART_sendString(password_arr);
+	/* The timer is re-armed here and not in its call back, so only one poll is queued at a time.
+	   Nobody is at the door if the keypad is in standby while the flow waits for a key, so the
+	   polling stops until the key that wakes the keypad up posts the next poll */
+	if((KEYPAD_isStandby() == FALSE) || (hmi_waits_key == FALSE))
+	{
+		Timer_start(KEYPAD_TIMER_ID,KEYPAD_POLL_MS,KEYPAD_POLL_CALLBACK);
 	}
+}
 
-	return;
+/*
+ * Description :
+ * Handler of the key pressed event, puts the key in the type ahead buffer unless the screen
+ * shown now discards the keys, resumes the HMI flow & sends the cells it changed to the LCD
+ */
+void KEY_PRESSED(uint8 key)
+{
+	if(key_policy != KEY_DISCARD)
+	{
+		TYPE_AHEAD_PUT(key);
+	}
+	HMI_FLOW(&hmi_context);
+	LCD_flush();
 }
 
+
 /*******************************************************************************
  *******************************************************************************
  *                             Main Function                                   *
@@ -455,132 +740,44 @@ void CHANGE_PASSWORD_CHOICE(void)
 
 int main(void)
 {
-	/* Variable to be used in the for loop */
-	uint8 i;
-
-	/* declaring choice variable to use it in the program */
-	uint8 choice = 0;
+	/* Starting the system tick that all the delays & timeouts are built on, the LCD writes are
+	   queued & done from the tick ISR which also scans the keypad */
+	Timer_initSystemTick();
 
 	LCD_init();
+	KEYPAD_init();
+#if TICK_PROBE
+	GPIO_setupPinDirection(TICK_PROBE_PORT_ID,TICK_PROBE_PIN_ID,PIN_OUTPUT);
+#endif
+	Timer0_setCallBack(TICK_CALLBACK);
 
 	/*Setting up the Configuration object for UART */
-	UART_config.Baud_Rate = 9600;
 	UART_config.Bits_Number = _8_BITS;
 	UART_config.Parity = EVEN_PARITY;
 	UART_config.Stop_Bits_Number = _1_STOP_BIT;
 
-	/* Initializing UART */
+	/* Initializing UART & the frame parser on top of it */
 	UART_init(&UART_config);
+	PROTOCOL_init();
 
-	/* The Program starts as follows
-	 * 1. Show a welcome message for the user
-	 * 2. Takes the password from the user and send it to MC2
-	 * 3. Menu shows on the LCD to choose between opening the door or changing the password
-	 * 4. if it's required to change the password, the existing password is required twice then
-	 *    you can change the password
-	 * 5. if it's required to open the door, the existing password is required twice then the
-	 *    the door is opened
-	 * 6. if the wring password entered for 3 times in row, buzzer is fired for 10 seconds
-	 */
-
+	/* Enable interrupts */
+	SREG |= (1<<7);
 
 	/* Showing the welcome message */
-	LCD_displayStringRowColumn(0,3,"Welcome !");
-
-	/* While loop to confirm that the input password is correctly taken from the user */
-	while((strcmp(password_arr,password_confirm_arr)) != 0)
-	{
-
-		/* checks if this is the first time the program enters this loop or not */
-		if(confirm_check != 0)
-		{
-			LCD_displayStringRowColumn(0,0,"Password not");
-			LCD_displayStringRowColumn(1,0,"Confirmed");
-			LCD_displayStringRowColumn(2,0,"Please re-enter");
-			LCD_displayStringRowColumn(3,0,"your password !");
-
-			/* delay for 5 seconds until the user reads the message */
-			_delay_second(5);
-
-			LCD_clearScreen();
-		}
-
-
-		/*Takes the password from the user and send it to MC2 */
-		LCD_displayStringRowColumn(1,0,"Enter Password");
-		LCD_displayStringRowColumn(2,0,"of 5 numbers !");
-		LCD_moveCursor(3,6);
-
-		/* A Loop to take the input password from the user */
-		for(i=0; i<5; i++)
-		{
-			password_arr[i] =  KEYPAD_getPressedKey();
-			LCD_displayCharacter('*');
-
-			/* delay for 500 milli second until the button is released */
-			_delay_milli_second(50);
-
-		}
-		/* Inserting '#' at the end of the password so that the MC2 Stops on reading it */
-		password_arr[5] = '#';
-		/* Inserting the null '\0' at the end of the password so that the MC1
-	       stops on sending it */
-		password_arr[6] = '\0';
-
-		LCD_clearScreen();
-
-		/*confirming the password entered from the user*/
-		LCD_displayStringRowColumn(1,0,"Please Confirm");
-		LCD_displayStringRowColumn(2,0,"your password !");
-		LCD_moveCursor(3,6);
-
-		/* A Loop to take the input password from the user */
-		for(i=0; i<5; i++)
-		{
-			password_confirm_arr[i] =  KEYPAD_getPressedKey();
-			LCD_displayCharacter('*');
-
-			/* delay for 500 milli second until the button is released */
-			_delay_milli_second(50);
-
-		}
-		/* Inserting '#' at the end of the password so that the MC2 Stops on reading it */
-		password_confirm_arr[5] = '#';
-		/* Inserting the null '\0' at the end of the password so that the MC1
-	       stops on sending it */
-		password_confirm_arr[6] = '\0';
-
-		LCD_clearScreen();
-
-		/* changing the value of the confirm_check variable to recognize that the loop has
-		   been entered  */
-		confirm_check = 1;
-	}
-
-	/* re-set the value of confirm_check variable */
-	confirm_check = 0;
-
-	/*sending the confirmed password for MC2 */
-	UART_sendString(password_arr);
-
-
-	/* Showing the menu to choose between opening the door or changing the password */
-	while(1)
-	{
-		LCD_displayStringRowColumn(1,0,"+: Open the door");
-		LCD_displayStringRowColumn(2,0,"-: Change the");
-		LCD_displayStringRowColumn(3,3,"password");
-
-		/* taking the choice from the user*/
-		choice = KEYPAD_getPressedKey();
-
-		switch(choice)
-		{
-		case '+': DOOR_CHOICE();
-		          break;
-		case '-': CHANGE_PASSWORD_CHOICE();
-		          break;
-		}
-		LCD_clearScreen();
-	}
+	MESSAGES_display(0,3,MSG_WELCOME);
+
+	/* The keypad is scanned periodically, every new key press & every scan resume the HMI
+	   flow that waits for keys, MC2 replies & messages timeouts without blocking */
+	SCHEDULER_init();
+	SCHEDULER_setHandler(EVENT_KEYPAD_POLL,KEYPAD_POLL);
+	SCHEDULER_setHandler(EVENT_KEY_PRESSED,KEY_PRESSED);
+
+	/* The CPU sleeps whenever no event is queued, until the next interrupt */
+	POWER_init();
+	POWER_setWakeCallBack(KEYPAD_POLL_CALLBACK);
+	SCHEDULER_setIdleCallBack(POWER_idle);
+	Timer_start(KEYPAD_TIMER_ID,KEYPAD_POLL_MS,KEYPAD_POLL_CALLBACK);
+
+	CO_INIT(&hmi_context);
+	SCHEDULER_run();
 }
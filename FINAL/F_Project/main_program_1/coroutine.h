@@ -0,0 +1,87 @@
+ /******************************************************************************
+ *
+ * Module: Coroutine
+ *
+ * File Name: coroutine.h
+ *
+ * Description: Stackless coroutines (protothreads) to write the long HMI flows sequentially
+ *
+ * Author: Belal Badr
+ *
+ *******************************************************************************/
+
+#ifndef COROUTINE_H_
+#define COROUTINE_H_
+
+#include "std_types.h"
+#include "timer.h"
+
+/*
+ * A coroutine is a function returning CO_StatusType whose body is written between CO_BEGIN
+ * and CO_END. Every wait saves the line number in the local continuation of its context and
+ * returns CO_WAITING, the next call jumps back to that line through the switch of CO_BEGIN,
+ * so all the coroutines share the single stack and cost two bytes of context each.
+ *
+ * Rules of use:
+ * 1. Local variables are lost on every wait, use static variables for the values that must
+ *    survive a wait.
+ * 2. No switch statement in the body of a coroutine, and no two waits on the same line.
+ * 3. The coroutine is called again (e.g. on every event) until it returns CO_DONE.
+ */
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+typedef enum
+{
+	CO_WAITING,CO_DONE
+}CO_StatusType;
+
+typedef struct
+{
+	uint16 lc; /* local continuation, the line to resume at or 0 at the beginning */
+}CO_ContextType;
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Restart the coroutine from its beginning on the next call */
+#define CO_INIT(ctx)                     ((ctx)->lc = 0)
+
+/* Start & end of the body of a coroutine */
+#define CO_BEGIN(ctx)                    switch((ctx)->lc) { case 0:
+#define CO_END(ctx)                      } (ctx)->lc = 0; return CO_DONE
+
+/* Wait until the condition is true, it is checked again on every call */
+#define CO_WAIT_UNTIL(ctx,condition)                                      \
+	do {                                                                  \
+		(ctx)->lc = __LINE__; case __LINE__:                              \
+		if(!(condition)) { return CO_WAITING; }                           \
+	} while(0)
+
+/* Give the CPU back once and resume on the next call */
+#define CO_YIELD(ctx)                                                     \
+	do {                                                                  \
+		(ctx)->lc = __LINE__; return CO_WAITING; case __LINE__: ;         \
+	} while(0)
+
+/* Leave the coroutine before its end */
+#define CO_EXIT(ctx)                     do { (ctx)->lc = 0; return CO_DONE; } while(0)
+
+/* Run a child coroutine with its own context until it is done, "call" is evaluated again on
+   every resume so its arguments must not have side effects */
+#define CO_SPAWN(ctx,child_ctx,call)                                      \
+	do {                                                                  \
+		CO_INIT(child_ctx);                                               \
+		CO_WAIT_UNTIL(ctx,(call) == CO_DONE);                             \
+	} while(0)
+
+/* Wait for the given milli-seconds on the system tick, "deadline" must be a static uint32 */
+#define CO_DELAY(ctx,deadline,m_seconds)                                  \
+	do {                                                                  \
+		(deadline) = Timer_deadline(m_seconds);                           \
+		CO_WAIT_UNTIL(ctx,Timer_isExpired(deadline));                     \
+	} while(0)
+
+#endif /* COROUTINE_H_ */
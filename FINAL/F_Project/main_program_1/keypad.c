@@ -12,6 +12,54 @@
 #include "common_macros.h" /* To use the macros like SET_BIT */
 #include "keypad.h"
 #include "gpio.h"
+#include <avr/io.h> /* To use the SREG Register */
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+#define KEYPAD_NUM_KEYS                  (KEYPAD_NUM_ROWS * KEYPAD_NUM_COLS)
+
+/* Pins of the rows & of the columns in the keypad port */
+#define KEYPAD_ROWS_MASK                 (((1 << KEYPAD_NUM_ROWS) - 1) << KEYPAD_FIRST_ROW_PIN_ID)
+#define KEYPAD_COLUMNS_MASK              (((1 << KEYPAD_NUM_COLS) - 1) << KEYPAD_FIRST_COLUMN_PIN_ID)
+
+#if (KEYPAD_NUM_KEYS > 16)
+#error "The keys bitmap is 16 bits wide"
+#endif
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/*
+ * Integrating debounce counter of every key (0 .. KEYPAD_DEBOUNCE_SAMPLES), the debounced
+ * state & the keys whose counter is between its limits, one bit per key in the bitmaps with
+ * index = col * KEYPAD_NUM_ROWS + row.
+ * A key that is stable in its debounced state has nothing to integrate, so a scan of an
+ * idle keypad costs the matrix read and one compare.
+ */
+static uint8 g_integrators[KEYPAD_NUM_KEYS];
+static volatile uint16 g_keysState = 0;
+static uint16 g_bouncingKeys = 0;
+
+/* Index of the last pressed key while it is held & number of ticks it has been held */
+static uint8 g_heldKey = KEYPAD_NO_KEY;
+static uint16 g_heldTicks = 0;
+
+/* All the columns are driven & only the rows are read until a key is pressed */
+static volatile boolean g_standby = FALSE;
+
+/* Number of scans rejected because of a ghost pattern */
+static volatile uint8 g_ghostCount = 0;
+
+/*
+ * Events FIFO, the tick ISR is the only producer & the application is the only consumer, so
+ * it needs no critical section.
+ */
+static volatile KEYPAD_EventType g_events[KEYPAD_EVENTS_SIZE];
+static volatile uint8 g_eventsHead = 0; /* written by the tick ISR only */
+static volatile uint8 g_eventsTail = 0; /* written by the application only */
+static volatile uint8 g_overflowCount = 0;
 
 /*******************************************************************************
  *                      Functions Prototypes(Private)                          *
@@ -31,47 +79,355 @@ static uint8 KEYPAD_4x3_adjustKeyNumber(uint8 button_number);
 static uint8 KEYPAD_4x4_adjustKeyNumber(uint8 button_number);
 #endif
 
+/*
+ * Read the whole matrix in one pass and return the raw pressed keys bitmap.
+ */
+static uint16 KEYPAD_scanMatrix(void);
+
+/*
+ * Return TRUE if the raw bitmap has a ghost pattern: without diodes, three pressed keys on
+ * the corners of a rectangle make the fourth corner look pressed, so any two columns sharing
+ * two or more pressed rows are ambiguous.
+ */
+static boolean KEYPAD_isGhost(uint16 matrix);
+
+/*
+ * Push an event of the key having the given index to the FIFO.
+ */
+static void KEYPAD_pushEvent(uint8 index, KEYPAD_EventKind kind);
+
+/*
+ * Map the index of a key in the matrix to its value.
+ */
+static uint8 KEYPAD_keyValue(uint8 index);
+
+/*
+ * Return the rows bitmap of the pressed keys in all the driven columns.
+ */
+static uint8 KEYPAD_readRows(void);
+
+/*
+ * Release all the columns, they are inputs until they are driven again.
+ */
+static void KEYPAD_releaseColumns(void);
+
 /*******************************************************************************
  *                      Functions Definitions                                  *
  *******************************************************************************/
-uint8 KEYPAD_getPressedKey(void)
+void KEYPAD_init(void)
 {
-	uint8 col,row;
-	uint8 keypad_port_value = 0;
-	while(1)
+	uint8 i;
+
+	for(i=0; i<KEYPAD_NUM_KEYS; i++)
 	{
-		for(col=0;col<KEYPAD_NUM_COLS;col++) /* loop for columns */
-		{
-			/* 
-			 * Each time setup the direction for all keypad port as input pins,
-			 * except this column will be output pin
-			 */
-			GPIO_setupPortDirection(KEYPAD_PORT_ID,PORT_INPUT);
-			GPIO_setupPinDirection(KEYPAD_PORT_ID,KEYPAD_FIRST_COLUMN_PIN_ID+col,PIN_OUTPUT);
-			
+		g_integrators[i] = 0;
+	}
+	g_keysState = 0;
+	g_bouncingKeys = 0;
+	g_heldKey = KEYPAD_NO_KEY;
+	g_standby = FALSE;
+	g_ghostCount = 0;
+	g_eventsHead = 0;
+	g_eventsTail = 0;
+	g_overflowCount = 0;
+
+	/* All the keypad pins are inputs, a column is an output only while it is read */
+	GPIO_FAST_SETUP_MASKED(KEYPAD_PORT_ID,KEYPAD_ROWS_MASK | KEYPAD_COLUMNS_MASK,PORT_INPUT);
+#if(KEYPAD_BUTTON_PRESSED == LOGIC_LOW)
+	/* Internal pull up on the rows & on the released columns */
+	GPIO_FAST_WRITE_MASKED(KEYPAD_PORT_ID,KEYPAD_ROWS_MASK | KEYPAD_COLUMNS_MASK,0xFF);
+#else
+	/* External pull down resistors, no internal pull up */
+	GPIO_FAST_WRITE_MASKED(KEYPAD_PORT_ID,KEYPAD_ROWS_MASK | KEYPAD_COLUMNS_MASK,0x00);
+#endif
+}
+
+static uint16 KEYPAD_scanMatrix(void)
+{
+	uint16 matrix = 0;
+	uint8 col = KEYPAD_NUM_COLS;
+	uint8 col_mask;
+
+	/* Last column first, so every column is shifted into place by a constant shift.
+	   The port registers are resolved at compile time instead of driving & reading every
+	   column through the GPIO functions */
+	while(col > 0)
+	{
+		col--;
+		col_mask = (1 << (KEYPAD_FIRST_COLUMN_PIN_ID + col));
+
+		/* Drive this column only, the other columns are released inputs */
+		GPIO_FAST_SETUP_MASKED(KEYPAD_PORT_ID,KEYPAD_COLUMNS_MASK,col_mask);
+#if(KEYPAD_BUTTON_PRESSED == LOGIC_LOW)
+		GPIO_FAST_WRITE_MASKED(KEYPAD_PORT_ID,KEYPAD_COLUMNS_MASK,~col_mask);
+#else
+		GPIO_FAST_WRITE_MASKED(KEYPAD_PORT_ID,KEYPAD_COLUMNS_MASK,col_mask);
+#endif
+
+		/* Let the rows released by the previous column rise through the pull ups & pass the
+		   input synchronizer before they are read, with NOPs as _delay_us calls floating
+		   point functions at -O0 which would not fit in the tick ISR */
+		GPIO_DELAY_NS(KEYPAD_SETTLE_NS);
+
+		matrix = (matrix << KEYPAD_NUM_ROWS) | KEYPAD_readRows();
+	}
+
+	/* Release all the columns until the next scan */
+	KEYPAD_releaseColumns();
+
+	return matrix;
+}
+
+static uint8 KEYPAD_readRows(void)
+{
+	uint8 rows;
+
+#if(KEYPAD_BUTTON_PRESSED == LOGIC_LOW)
+	rows = GPIO_FAST_READ_MASKED(KEYPAD_PORT_ID,KEYPAD_ROWS_MASK) ^ KEYPAD_ROWS_MASK;
+#else
+	rows = GPIO_FAST_READ_MASKED(KEYPAD_PORT_ID,KEYPAD_ROWS_MASK);
+#endif
+	return (rows >> KEYPAD_FIRST_ROW_PIN_ID);
+}
+
+static void KEYPAD_releaseColumns(void)
+{
+	GPIO_FAST_SETUP_MASKED(KEYPAD_PORT_ID,KEYPAD_COLUMNS_MASK,PORT_INPUT);
+#if(KEYPAD_BUTTON_PRESSED == LOGIC_LOW)
+	GPIO_FAST_WRITE_MASKED(KEYPAD_PORT_ID,KEYPAD_COLUMNS_MASK,0xFF);
+#else
+	GPIO_FAST_WRITE_MASKED(KEYPAD_PORT_ID,KEYPAD_COLUMNS_MASK,0x00);
+#endif
+}
+
+boolean KEYPAD_standby(void)
+{
+	/* Wait until every key is released & settled, so no event is lost while the keys can not
+	   be told apart */
+	if((g_keysState != 0) || (g_bouncingKeys != 0))
+	{
+		return FALSE;
+	}
+
+	/* Drive all the columns, a press on any key activates its row */
+	GPIO_FAST_SETUP_MASKED(KEYPAD_PORT_ID,KEYPAD_COLUMNS_MASK,PORT_OUTPUT);
 #if(KEYPAD_BUTTON_PRESSED == LOGIC_LOW)
-			/* Clear the column output pin and set the rest pins value */
-			keypad_port_value = ~(1<<(KEYPAD_FIRST_COLUMN_PIN_ID+col));
+	GPIO_FAST_WRITE_MASKED(KEYPAD_PORT_ID,KEYPAD_COLUMNS_MASK,0x00);
 #else
-			/* Set the column output pin and clear the rest pins value */
-			keypad_port_value = (1<<(KEYPAD_FIRST_COLUMN_PIN_ID+col));
+	GPIO_FAST_WRITE_MASKED(KEYPAD_PORT_ID,KEYPAD_COLUMNS_MASK,0xFF);
 #endif
-			GPIO_writePort(KEYPAD_PORT_ID,keypad_port_value);
+	g_standby = TRUE;
+
+	return TRUE;
+}
+
+boolean KEYPAD_isStandby(void)
+{
+	return g_standby;
+}
+
+static boolean KEYPAD_isGhost(uint16 matrix)
+{
+	uint8 i;
+	uint8 j;
+	uint8 common;
+	uint16 others;
+
+	/* A ghost needs three pressed keys at least, clear the two lowest keys to check it */
+	others = matrix & (matrix - 1);
+	others &= (others - 1);
+	if(others == 0)
+	{
+		return FALSE;
+	}
+
+	for(i=0; i<KEYPAD_NUM_COLS; i++)
+	{
+		for(j=i+1; j<KEYPAD_NUM_COLS; j++)
+		{
+			common = (uint8)(matrix >> (i * KEYPAD_NUM_ROWS)) & (uint8)(matrix >> (j * KEYPAD_NUM_ROWS));
+			common &= ((1 << KEYPAD_NUM_ROWS) - 1);
+
+			/* Two rows or more in common */
+			if((common & (common - 1)) != 0)
+			{
+				return TRUE;
+			}
+		}
+	}
+	return FALSE;
+}
+
+static void KEYPAD_pushEvent(uint8 index, KEYPAD_EventKind kind)
+{
+	uint8 next_head = (g_eventsHead + 1) & KEYPAD_EVENTS_MASK;
+
+	if(next_head == g_eventsTail)
+	{
+		/* FIFO is full, drop the event */
+		g_overflowCount++;
+		return;
+	}
+	g_events[g_eventsHead].key = KEYPAD_keyValue(index);
+	g_events[g_eventsHead].kind = kind;
+	g_eventsHead = next_head;
+}
+
+void KEYPAD_tick(void)
+{
+	uint16 matrix;
+	uint16 state = g_keysState;
+	uint16 changed;
+	uint16 key_bit;
+	uint8 index;
+
+	if(g_standby)
+	{
+		if(KEYPAD_readRows() == 0)
+		{
+			/* Still no key pressed */
+			return;
+		}
+
+		/* A key woke the keypad up, scan it from this tick, its press is debounced as usual */
+		KEYPAD_releaseColumns();
+		g_standby = FALSE;
+	}
 
-			for(row=0;row<KEYPAD_NUM_ROWS;row++) /* loop for rows */
+	matrix = KEYPAD_scanMatrix();
+
+	if(KEYPAD_isGhost(matrix))
+	{
+		/* Ambiguous pass, keep every key where it is until the matrix can be read again */
+		g_ghostCount++;
+	}
+	else
+	{
+		/* Only the keys that differ from their debounced state or are still bouncing */
+		changed = (matrix ^ state) | g_bouncingKeys;
+
+		for(index=0; changed != 0; index++, changed >>= 1)
+		{
+			if((changed & 1) == 0)
+			{
+				continue;
+			}
+			key_bit = (1U << index);
+
+			if(matrix & key_bit)
+			{
+				/* Integrate up, the press is accepted when the counter reaches its top */
+				g_integrators[index]++;
+				if(g_integrators[index] == KEYPAD_DEBOUNCE_SAMPLES)
+				{
+					g_bouncingKeys &= ~key_bit;
+					if((state & key_bit) == 0)
+					{
+						state |= key_bit;
+						KEYPAD_pushEvent(index,KEYPAD_PRESSED);
+						g_heldKey = index;
+						g_heldTicks = 0;
+					}
+				}
+				else
+				{
+					g_bouncingKeys |= key_bit;
+				}
+			}
+			else
 			{
-				/* Check if the switch is pressed in this row */
-				if(GPIO_readPin(KEYPAD_PORT_ID,row+KEYPAD_FIRST_ROW_PIN_ID) == KEYPAD_BUTTON_PRESSED)
+				/* Integrate down, the release is accepted when the counter reaches zero */
+				g_integrators[index]--;
+				if(g_integrators[index] == 0)
 				{
-					#if (KEYPAD_NUM_COLS == 3)
-						return KEYPAD_4x3_adjustKeyNumber((row*KEYPAD_NUM_COLS)+col+1);
-					#elif (KEYPAD_NUM_COLS == 4)
-						return KEYPAD_4x4_adjustKeyNumber((row*KEYPAD_NUM_COLS)+col+1);
-					#endif
+					g_bouncingKeys &= ~key_bit;
+					if((state & key_bit) != 0)
+					{
+						state &= ~key_bit;
+						KEYPAD_pushEvent(index,KEYPAD_RELEASED);
+						if(g_heldKey == index)
+						{
+							g_heldKey = KEYPAD_NO_KEY;
+						}
+					}
+				}
+				else
+				{
+					g_bouncingKeys |= key_bit;
 				}
 			}
 		}
-	}	
+		g_keysState = state;
+	}
+
+	if(g_heldKey != KEYPAD_NO_KEY)
+	{
+		g_heldTicks++;
+		if(g_heldTicks == KEYPAD_LONG_PRESS_MS)
+		{
+			KEYPAD_pushEvent(g_heldKey,KEYPAD_LONG_PRESSED);
+		}
+	}
+}
+
+boolean KEYPAD_getEvent(KEYPAD_EventType *event)
+{
+	if(g_eventsTail == g_eventsHead)
+	{
+		return FALSE;
+	}
+	event->key = g_events[g_eventsTail].key;
+	event->kind = g_events[g_eventsTail].kind;
+	g_eventsTail = (g_eventsTail + 1) & KEYPAD_EVENTS_MASK;
+
+	return TRUE;
+}
+
+uint8 KEYPAD_getPressedKey(void)
+{
+	KEYPAD_EventType event;
+
+	/* Keep waiting until a key press event is received */
+	while((KEYPAD_getEvent(&event) == FALSE) || (event.kind != KEYPAD_PRESSED)){}
+
+	return event.key;
+}
+
+uint16 KEYPAD_getKeysState(void)
+{
+	uint16 state;
+	uint8 sreg = SREG;
+
+	/* The bitmap is written by the tick ISR, read its two bytes atomically */
+	SREG &= ~(1<<7);
+	state = g_keysState;
+	SREG = sreg;
+
+	return state;
+}
+
+uint8 KEYPAD_getOverflowCount(void)
+{
+	return g_overflowCount;
+}
+
+uint8 KEYPAD_getGhostCount(void)
+{
+	return g_ghostCount;
+}
+
+static uint8 KEYPAD_keyValue(uint8 index)
+{
+	uint8 row = index % KEYPAD_NUM_ROWS;
+	uint8 col = index / KEYPAD_NUM_ROWS;
+	uint8 button_number = (row * KEYPAD_NUM_COLS) + col + 1;
+
+	/* the switch number is (row*KEYPAD_NUM_COLS)+col+1 */
+	#if (KEYPAD_NUM_COLS == 3)
+		return KEYPAD_4x3_adjustKeyNumber(button_number);
+	#elif (KEYPAD_NUM_COLS == 4)
+		return KEYPAD_4x4_adjustKeyNumber(button_number);
+	#endif
 }
 
 #if (KEYPAD_NUM_COLS == 3)
@@ -33,14 +33,107 @@
 #define KEYPAD_BUTTON_PRESSED            LOGIC_LOW
 #define KEYPAD_BUTTON_RELEASED           LOGIC_HIGH
 
+/* Value of "no key" (0 is a valid key) */
+#define KEYPAD_NO_KEY                    (0xFF)
+
+/* Time the rows get to settle after a column is driven, in nano-seconds */
+#define KEYPAD_SETTLE_NS                 2000
+
+/* Number of consecutive samples (one every tick) that the integrating debounce needs to
+   accept a press or a release */
+#define KEYPAD_DEBOUNCE_SAMPLES          10
+
+/* Time a key is held before its long press event, in system ticks (ms) */
+#define KEYPAD_LONG_PRESS_MS             1000
+
+/* Number of events that can wait in the FIFO, must be a power of 2 */
+#define KEYPAD_EVENTS_SIZE               8
+#define KEYPAD_EVENTS_MASK               (KEYPAD_EVENTS_SIZE - 1)
+
+#if ((KEYPAD_EVENTS_SIZE & KEYPAD_EVENTS_MASK) != 0)
+#error "KEYPAD_EVENTS_SIZE must be a power of 2"
+#endif
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+typedef enum
+{
+	KEYPAD_PRESSED,KEYPAD_RELEASED,KEYPAD_LONG_PRESSED
+}KEYPAD_EventKind;
+
+typedef struct
+{
+	uint8 key;              /* same value as returned by KEYPAD_getPressedKey */
+	KEYPAD_EventKind kind;
+}KEYPAD_EventType;
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
 
 /*
  * Description :
- * Get the Keypad pressed button
+ * Initialize the keypad pins & the debounce state, all the columns are released.
+ */
+void KEYPAD_init(void);
+
+/*
+ * Description :
+ * Scan the keypad, it must be called every system tick (from the tick ISR):
+ * 1. reads the whole matrix in one pass into a bitmap of the pressed keys
+ * 2. rejects the pass if it has a ghost pattern (see KEYPAD_getGhostCount)
+ * 3. debounces every key that changed & pushes the press, release & long press events to
+ *    the events FIFO, several keys held together (a chord) get their own events
+ */
+void KEYPAD_tick(void);
+
+/*
+ * Description :
+ * Put the keypad in standby if no key is pressed or bouncing, returns TRUE if it is in standby.
+ * All the columns are driven and KEYPAD_tick only reads the rows until a key is pressed, then
+ * the keypad is scanned again & the press is debounced, so the key is not lost.
+ * It must be called from the tick ISR, like KEYPAD_tick.
+ */
+boolean KEYPAD_standby(void);
+
+/*
+ * Description :
+ * Return TRUE while the keypad is in standby.
+ */
+boolean KEYPAD_isStandby(void);
+
+/*
+ * Description :
+ * Take the oldest keypad event from the FIFO, returns FALSE if there is no event.
+ */
+boolean KEYPAD_getEvent(KEYPAD_EventType *event);
+
+/*
+ * Description :
+ * Wait for the next key press and return its key, the release & long press events before
+ * it are dropped. KEYPAD_tick must be running.
  */
 uint8 KEYPAD_getPressedKey(void);
 
+/*
+ * Description :
+ * Return the bitmap of the debounced pressed keys, bit (col * KEYPAD_NUM_ROWS + row) is a key,
+ * more than one bit set is a chord.
+ */
+uint16 KEYPAD_getKeysState(void);
+
+/*
+ * Description :
+ * Return the number of events dropped because the FIFO was full.
+ */
+uint8 KEYPAD_getOverflowCount(void);
+
+/*
+ * Description :
+ * Return the number of scans rejected because three pressed keys made a ghost key, these scans
+ * leave the debounced state as it was.
+ */
+uint8 KEYPAD_getGhostCount(void);
+
 #endif /* KEYPAD_H_ */
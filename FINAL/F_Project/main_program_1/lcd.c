@@ -11,10 +11,148 @@
  *******************************************************************************/
 
 #include <util/delay.h> /* For the delay functions */
+#include <avr/pgmspace.h> /* To read the strings stored in the flash */
+#include <stdarg.h> /* For the variable arguments of LCD_printf_P */
 #include "common_macros.h" /* To use the macros like SET_BIT */
 #include "lcd.h"
 #include "gpio.h"
 
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Write RS & RW, in one masked write when they share a port so the LCD never sees a mix of
+   the old & new values on its control lines */
+#if (LCD_RS_PORT_ID == LCD_RW_PORT_ID)
+#define LCD_WRITE_RS_RW(rs,rw)                                            \
+	GPIO_FAST_WRITE_MASKED(LCD_RS_PORT_ID,(1<<LCD_RS_PIN_ID) | (1<<LCD_RW_PIN_ID), \
+		(((rs) != LOGIC_LOW) ? (1<<LCD_RS_PIN_ID) : 0) | (((rw) != LOGIC_LOW) ? (1<<LCD_RW_PIN_ID) : 0))
+#else
+#define LCD_WRITE_RS_RW(rs,rw)                                            \
+	do {                                                                  \
+		GPIO_FAST_WRITE_PIN(LCD_RS_PORT_ID,LCD_RS_PIN_ID,rs);             \
+		GPIO_FAST_WRITE_PIN(LCD_RW_PORT_ID,LCD_RW_PIN_ID,rw);             \
+	} while(0)
+#endif
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+/*
+ * Shadow buffer of the screen & one dirty bit per cell that differs from the screen.
+ * The display functions write into it, LCD_flush sends the dirty cells only.
+ */
+static uint8 g_shadow[LCD_ROWS][LCD_COLS];
+static uint8 g_dirty[LCD_CELLS / 8];
+
+/* cursor of the shadow buffer */
+static uint8 g_cursorRow = 0;
+static uint8 g_cursorCol = 0;
+
+/* DDRAM address the LCD writes the next character at, LCD_NO_ADDRESS if not known */
+#define LCD_NO_ADDRESS                 (0xFF)
+static uint8 g_lcdAddress = LCD_NO_ADDRESS;
+
+/* Powers of 10 used to get the decimal digits by subtraction, the AVR has no divider */
+static const uint32 g_powersOf10[] PROGMEM =
+{
+	1UL,10UL,100UL,1000UL,10000UL,100000UL,1000000UL,10000000UL,100000000UL,1000000000UL
+};
+#define LCD_MAX_DECIMAL_DIGITS         10
+#define LCD_MAX_HEX_DIGITS             8
+
+/* Glyph pattern resident in every CGRAM slot (NULL_PTR if free) & the slots ordered from
+   the most to the least recently used */
+static const uint8 *g_glyphs[LCD_GLYPH_SLOTS];
+static uint8 g_glyphLru[LCD_GLYPH_SLOTS];
+
+/* Progress bar cells filled by 1 to 4 pixel columns, the rows under the bar are empty */
+static const uint8 g_barGlyphs[LCD_GLYPH_WIDTH - 1][LCD_GLYPH_HEIGHT] PROGMEM =
+{
+	{0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x00},
+	{0x18,0x18,0x18,0x18,0x18,0x18,0x18,0x00},
+	{0x1C,0x1C,0x1C,0x1C,0x1C,0x1C,0x1C,0x00},
+	{0x1E,0x1E,0x1E,0x1E,0x1E,0x1E,0x1E,0x00}
+};
+
+#if (LCD_USE_BUSY_FLAG == 0)
+/* last command sent, the clear & home commands take much longer than the others */
+static uint8 g_lastCommand = 0;
+#endif
+
+#if (LCD_ASYNC_QUEUE == 1)
+typedef struct
+{
+	uint8 rs;
+	uint8 data;
+}LCD_WriteType;
+
+/* Writes queue, filled by the application & drained by the tick ISR */
+static volatile LCD_WriteType g_queue[LCD_QUEUE_SIZE];
+static volatile uint8 g_queueHead = 0; /* written by the application only */
+static volatile uint8 g_queueTail = 0; /* written by the tick ISR only */
+
+#if (LCD_USE_BUSY_FLAG == 0)
+/* ticks to skip after a clear/home command */
+static uint8 g_waitTicks = 0;
+#endif
+#endif
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+#if (LCD_ASYNC_QUEUE == 0)
+/*
+ * Wait until the LCD is ready for the next command/character.
+ */
+static void LCD_waitReady(void);
+#endif
+
+/*
+ * Strobe one byte to the LCD as a command (rs = LOGIC_LOW) or a character (rs = LOGIC_HIGH),
+ * the LCD must be ready.
+ */
+static void LCD_strobe(uint8 rs, uint8 data);
+
+#if (LCD_ASYNC_QUEUE == 0)
+/*
+ * Wait until the LCD is ready then write one byte to it.
+ */
+static void LCD_write(uint8 rs, uint8 data);
+#endif
+
+/*
+ * Queue one byte for the LCD (LCD_ASYNC_QUEUE mode) or write it directly.
+ */
+static void LCD_output(uint8 rs, uint8 data);
+
+/*
+ * Return the number of writes that can be queued without waiting.
+ */
+static uint8 LCD_queueFree(void);
+
+/*
+ * Return the DDRAM address of a specified row and column index.
+ */
+static uint8 LCD_address(uint8 row, uint8 col);
+
+/*
+ * Return TRUE if the character code is used by a cell of the shadow buffer.
+ */
+static boolean LCD_isOnScreen(uint8 code);
+
+/*
+ * Display a number in base 10 or 16 right aligned in the given width, with "precision"
+ * fraction digits for base 10 and the hex digits 10..15 starting at the letter "hex_a".
+ */
+static void LCD_printNumber(uint32 value, boolean negative, uint8 base, uint8 width, uint8 precision, uint8 pad, uint8 hex_a);
+
+/*
+ * Display a string from the SRAM or the flash right aligned in the given width.
+ */
+static void LCD_printString(const char *Str, boolean in_flash, uint8 width);
+
 /*******************************************************************************
  *                      Functions Definitions                                  *
  *******************************************************************************/
@@ -27,6 +165,8 @@
  */
 void LCD_init(void)
 {
+	uint8 i;
+
 	/* Configure the direction for RS, RW and E pins as output pins */
 	GPIO_setupPinDirection(LCD_RS_PORT_ID,LCD_RS_PIN_ID,PIN_OUTPUT);
 	GPIO_setupPinDirection(LCD_RW_PORT_ID,LCD_RW_PIN_ID,PIN_OUTPUT);
@@ -35,11 +175,283 @@ void LCD_init(void)
 	/* Configure the data port as output port */
 	GPIO_setupPortDirection(LCD_DATA_PORT_ID,PORT_OUTPUT);
 
+	/* The LCD ignores the commands until its power on reset is done */
+	_delay_ms(LCD_POWER_ON_DELAY_MS);
+
 	LCD_sendCommand(LCD_TWO_LINES_EIGHT_BITS_MODE); /* use 2-line lcd + 8-bit Data Mode + 5*7 dot display Mode */
 	
 	LCD_sendCommand(LCD_CURSOR_OFF); /* cursor off */
 	
 	LCD_sendCommand(LCD_CLEAR_COMMAND); /* clear LCD at the beginning */
+
+	/* the screen is blank, so is the shadow buffer */
+	LCD_clearScreen();
+	for(i=0; i<(LCD_CELLS / 8); i++)
+	{
+		g_dirty[i] = 0;
+	}
+
+	/* no glyph is uploaded yet */
+	for(i=0; i<LCD_GLYPH_SLOTS; i++)
+	{
+		g_glyphs[i] = NULL_PTR;
+		g_glyphLru[i] = i;
+	}
+}
+
+/*
+ * Description :
+ * Read the status of the LCD: the busy flag in bit 7 and the address counter in bits 0..6
+ */
+uint8 LCD_readStatus(void)
+{
+#if (LCD_USE_BUSY_FLAG == 1)
+	uint8 status;
+
+	GPIO_DDR_REG(LCD_DATA_PORT_ID) = PORT_INPUT; /* the LCD drives the data bus */
+	LCD_WRITE_RS_RW(LOGIC_LOW,LOGIC_HIGH); /* Instruction Mode RS=0, read from LCD so RW=1 */
+	GPIO_FAST_SET_PIN(LCD_E_PORT_ID,LCD_E_PIN_ID); /* Enable LCD E=1 */
+	GPIO_DELAY_NS(160); /* delay for processing Tddr = 160ns */
+	status = GPIO_PIN_REG(LCD_DATA_PORT_ID); /* read the busy flag & the address counter D0 --> D7 */
+	GPIO_FAST_CLEAR_PIN(LCD_E_PORT_ID,LCD_E_PIN_ID); /* Disable LCD E=0 */
+	GPIO_FAST_CLEAR_PIN(LCD_RW_PORT_ID,LCD_RW_PIN_ID); /* back to write RW=0 */
+	GPIO_DDR_REG(LCD_DATA_PORT_ID) = PORT_OUTPUT;
+
+	return status;
+#else
+	return 0;
+#endif
+}
+
+#if (LCD_ASYNC_QUEUE == 0)
+/*
+ * Description :
+ * Wait until the LCD is ready for the next command/character, by polling the busy flag
+ * (at most LCD_BUSY_POLL_LIMIT times) or by the worst case delay of the last command
+ */
+static void LCD_waitReady(void)
+{
+#if (LCD_USE_BUSY_FLAG == 1)
+	uint16 polls = 0;
+
+	while((LCD_readStatus() & (1<<LCD_BUSY_FLAG_BIT)) && (polls < LCD_BUSY_POLL_LIMIT))
+	{
+		polls++;
+	}
+#else
+	if((g_lastCommand == LCD_CLEAR_COMMAND) || (g_lastCommand == LCD_GO_TO_HOME))
+	{
+		_delay_us(LCD_CLEAR_DELAY_US);
+	}
+	else
+	{
+		_delay_us(LCD_COMMAND_DELAY_US);
+	}
+#endif
+}
+
+#endif
+
+static void LCD_strobe(uint8 rs, uint8 data)
+{
+	/* The pins are constants, so every access is resolved at compile time instead of a GPIO
+	   function call */
+	LCD_WRITE_RS_RW(rs,LOGIC_LOW); /* Instruction Mode RS=0, Data Mode RS=1, write data to LCD so RW=0 */
+	GPIO_PORT_REG(LCD_DATA_PORT_ID) = data; /* out the required byte to the data bus D0 --> D7 */
+	GPIO_FAST_SET_PIN(LCD_E_PORT_ID,LCD_E_PIN_ID); /* Enable LCD E=1 */
+	GPIO_DELAY_NS(230); /* delay for processing Tpw = 230ns */
+	GPIO_FAST_CLEAR_PIN(LCD_E_PORT_ID,LCD_E_PIN_ID); /* Disable LCD E=0 */
+
+#if (LCD_USE_BUSY_FLAG == 0)
+	g_lastCommand = (rs == LOGIC_LOW) ? data : 0;
+#endif
+}
+
+#if (LCD_ASYNC_QUEUE == 0)
+static void LCD_write(uint8 rs, uint8 data)
+{
+	/* The previous command/character must be done first */
+	LCD_waitReady();
+	LCD_strobe(rs,data);
+}
+#endif
+
+static uint8 LCD_queueFree(void)
+{
+#if (LCD_ASYNC_QUEUE == 1)
+	return (LCD_QUEUE_SIZE - 1) - ((g_queueHead - g_queueTail) & LCD_QUEUE_MASK);
+#else
+	return 0xFF;
+#endif
+}
+
+static void LCD_output(uint8 rs, uint8 data)
+{
+#if (LCD_ASYNC_QUEUE == 1)
+	/* Wait for a free entry, the tick ISR frees one at least every tick */
+	while(LCD_queueFree() == 0){}
+
+	g_queue[g_queueHead].rs = rs;
+	g_queue[g_queueHead].data = data;
+	g_queueHead = (g_queueHead + 1) & LCD_QUEUE_MASK;
+#else
+	LCD_write(rs,data);
+#endif
+}
+
+static boolean LCD_isOnScreen(uint8 code)
+{
+	uint8 row,col;
+
+	for(row=0; row<LCD_ROWS; row++)
+	{
+		for(col=0; col<LCD_COLS; col++)
+		{
+			if(g_shadow[row][col] == code)
+			{
+				return TRUE;
+			}
+		}
+	}
+	return FALSE;
+}
+
+/*
+ * Description :
+ * Return the character code of the glyph, uploading it to the CGRAM if it is not there
+ */
+uint8 LCD_getGlyph(const uint8 *pattern)
+{
+	uint8 i;
+	uint8 slot;
+
+	/* Look for the glyph from the most recently used slot */
+	for(i=0; i<LCD_GLYPH_SLOTS; i++)
+	{
+		if(g_glyphs[g_glyphLru[i]] == pattern)
+		{
+			break;
+		}
+	}
+
+	if(i == LCD_GLYPH_SLOTS)
+	{
+		/* Not resident, replace the least recently used glyph that is not on the screen, or
+		   the least recently used one if all of them are on the screen */
+		for(i=LCD_GLYPH_SLOTS; i>0; i--)
+		{
+			slot = g_glyphLru[i - 1];
+			if((g_glyphs[slot] == NULL_PTR) || (LCD_isOnScreen(slot) == FALSE))
+			{
+				break;
+			}
+		}
+		i = (i == 0) ? (LCD_GLYPH_SLOTS - 1) : (i - 1);
+		slot = g_glyphLru[i];
+
+		/* Upload the pattern, it is queued before the cells that use it */
+		LCD_output(LOGIC_LOW,LCD_SET_CGRAM_ADDRESS | (slot << 3));
+		for(slot=0; slot<LCD_GLYPH_HEIGHT; slot++)
+		{
+			LCD_output(LOGIC_HIGH,pgm_read_byte(&pattern[slot]));
+		}
+		slot = g_glyphLru[i];
+		g_glyphs[slot] = pattern;
+
+		/* the next characters need a DDRAM address command */
+		g_lcdAddress = LCD_NO_ADDRESS;
+	}
+
+	/* Move the slot to the front of the LRU order */
+	slot = g_glyphLru[i];
+	for(; i>0; i--)
+	{
+		g_glyphLru[i] = g_glyphLru[i - 1];
+	}
+	g_glyphLru[0] = slot;
+
+	return slot;
+}
+
+/*
+ * Description :
+ * Display a progress bar filled in proportion to value/max with a resolution of one pixel column
+ */
+void LCD_displayProgressBar(uint8 row, uint8 col, uint8 cells, uint16 value, uint16 max)
+{
+	uint16 columns = 0; /* number of pixel columns filled */
+	uint8 i;
+
+	if(value > max)
+	{
+		value = max;
+	}
+	if(max != 0)
+	{
+		columns = ((uint32)value * cells * LCD_GLYPH_WIDTH) / max;
+	}
+
+	LCD_moveCursor(row,col);
+	for(i=0; i<cells; i++)
+	{
+		if(columns >= LCD_GLYPH_WIDTH)
+		{
+			LCD_displayCharacter(LCD_FULL_BLOCK);
+			columns -= LCD_GLYPH_WIDTH;
+		}
+		else if(columns != 0)
+		{
+			/* only one cell is partly filled */
+			LCD_displayCharacter(LCD_getGlyph(g_barGlyphs[columns - 1]));
+			columns = 0;
+		}
+		else
+		{
+			LCD_displayCharacter(' ');
+		}
+	}
+}
+
+/*
+ * Description :
+ * Write the queued commands & characters to the LCD as long as it is not busy
+ */
+void LCD_processQueue(void)
+{
+#if (LCD_ASYNC_QUEUE == 1)
+	uint8 writes = 0;
+
+#if (LCD_USE_BUSY_FLAG == 0)
+	if(g_waitTicks != 0)
+	{
+		g_waitTicks--;
+		return;
+	}
+#endif
+
+	while((g_queueTail != g_queueHead) && (writes < LCD_QUEUE_WRITES_PER_TICK))
+	{
+#if (LCD_USE_BUSY_FLAG == 1)
+		/* Do not wait for the LCD in the ISR, try again on the next tick */
+		if(LCD_readStatus() & (1<<LCD_BUSY_FLAG_BIT))
+		{
+			break;
+		}
+#endif
+		LCD_strobe(g_queue[g_queueTail].rs,g_queue[g_queueTail].data);
+		g_queueTail = (g_queueTail + 1) & LCD_QUEUE_MASK;
+		writes++;
+
+#if (LCD_USE_BUSY_FLAG == 0)
+		/* a tick is longer than any write except clear & home */
+		if((g_lastCommand == LCD_CLEAR_COMMAND) || (g_lastCommand == LCD_GO_TO_HOME))
+		{
+			g_waitTicks = (LCD_CLEAR_DELAY_US + 999) / 1000;
+		}
+		break;
+#endif
+	}
+#endif
 }
 
 /*
@@ -48,15 +460,10 @@ void LCD_init(void)
  */
 void LCD_sendCommand(uint8 command)
 {
-	GPIO_writePin(LCD_RS_PORT_ID,LCD_RS_PIN_ID,LOGIC_LOW); /* Instruction Mode RS=0 */
-	GPIO_writePin(LCD_RW_PORT_ID,LCD_RW_PIN_ID,LOGIC_LOW); /* write data to LCD so RW=0 */
-	_delay_ms(1); /* delay for processing Tas = 50ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_HIGH); /* Enable LCD E=1 */
-	_delay_ms(1); /* delay for processing Tpw - Tdws = 190ns */
-	GPIO_writePort(LCD_DATA_PORT_ID,command); /* out the required command to the data bus D0 --> D7 */
-	_delay_ms(1); /* delay for processing Tdsw = 100ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW); /* Disable LCD E=0 */
-	_delay_ms(1); /* delay for processing Th = 13ns */
+	LCD_output(LOGIC_LOW,command);
+
+	/* the command may have moved the LCD address */
+	g_lcdAddress = LCD_NO_ADDRESS;
 }
 
 /*
@@ -65,15 +472,23 @@ void LCD_sendCommand(uint8 command)
  */
 void LCD_displayCharacter(uint8 data)
 {
-	GPIO_writePin(LCD_RS_PORT_ID,LCD_RS_PIN_ID,LOGIC_HIGH); /* Data Mode RS=1 */
-	GPIO_writePin(LCD_RW_PORT_ID,LCD_RW_PIN_ID,LOGIC_LOW); /* write data to LCD so RW=0 */
-	_delay_ms(1); /* delay for processing Tas = 50ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_HIGH); /* Enable LCD E=1 */
-	_delay_ms(1); /* delay for processing Tpw - Tdws = 190ns */
-	GPIO_writePort(LCD_DATA_PORT_ID,data); /* out the required command to the data bus D0 --> D7 */
-	_delay_ms(1); /* delay for processing Tdsw = 100ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW); /* Disable LCD E=0 */
-	_delay_ms(1); /* delay for processing Th = 13ns */
+	uint8 cell;
+	uint8 bit;
+
+	if((g_cursorRow >= LCD_ROWS) || (g_cursorCol >= LCD_COLS))
+	{
+		return;
+	}
+
+	/* Mark the cell dirty only if its character changes */
+	if(g_shadow[g_cursorRow][g_cursorCol] != data)
+	{
+		g_shadow[g_cursorRow][g_cursorCol] = data;
+		cell = (g_cursorRow * LCD_COLS) + g_cursorCol;
+		bit = cell & 7;
+		SET_BIT(g_dirty[cell >> 3],bit);
+	}
+	g_cursorCol++;
 }
 
 /*
@@ -97,13 +512,35 @@ void LCD_displayString(const char *Str)
 	*********************************************************/
 }
 
+/*
+ * Description :
+ * Display the required string stored in the flash (PROGMEM) on the screen
+ */
+void LCD_displayString_P(const char *Str)
+{
+	uint8 character;
+
+	/* every character is read from the flash, the string is never copied to the SRAM */
+	while((character = pgm_read_byte(Str)) != '\0')
+	{
+		LCD_displayCharacter(character);
+		Str++;
+	}
+}
+
 /*
  * Description :
  * Move the cursor to a specified row and column index on the screen
  */
 void LCD_moveCursor(uint8 row,uint8 col)
 {
-	uint8 lcd_memory_address;
+	g_cursorRow = row;
+	g_cursorCol = col;
+}
+
+static uint8 LCD_address(uint8 row, uint8 col)
+{
+	uint8 lcd_memory_address = 0;
 	
 	/* Calculate the required address in the LCD DDRAM */
 	switch(row)
@@ -120,9 +557,8 @@ void LCD_moveCursor(uint8 row,uint8 col)
 		case 3:
 			lcd_memory_address=col+0x50;
 				break;
-	}					
-	/* Move the LCD cursor to this specific address */
-	LCD_sendCommand(lcd_memory_address | LCD_SET_CURSOR_LOCATION);
+	}
+	return lcd_memory_address;
 }
 
 /*
@@ -135,22 +571,304 @@ void LCD_displayStringRowColumn(uint8 row,uint8 col,const char *Str)
 	LCD_displayString(Str); /* display the string */
 }
 
+/*
+ * Description :
+ * Display the required string stored in the flash (PROGMEM) in a specified row and column
+ * index on the screen
+ */
+void LCD_displayStringRowColumn_P(uint8 row,uint8 col,const char *Str)
+{
+	LCD_moveCursor(row,col); /* go to to the required LCD position */
+	LCD_displayString_P(Str); /* display the string */
+}
+
 /*
  * Description :
  * Display the required decimal value on the screen
  */
 void LCD_intgerToString(int data)
 {
-   char buff[16]; /* String to hold the ascii result */
-   itoa(data,buff,10); /* Use itoa C function to convert the data to its corresponding ASCII value, 10 for decimal */
-   LCD_displayString(buff); /* Display the string */
+	LCD_printf_P(PSTR("%d"),data);
+}
+
+static void LCD_printNumber(uint32 value, boolean negative, uint8 base, uint8 width, uint8 precision, uint8 pad, uint8 hex_a)
+{
+	uint8 digits = 1;
+	uint8 length;
+	uint8 digit;
+	uint32 power;
+	sint8 i;
+
+	/* Count the digits of the value */
+	if(base == 10)
+	{
+		while((digits < LCD_MAX_DECIMAL_DIGITS) && (value >= pgm_read_dword(&g_powersOf10[digits])))
+		{
+			digits++;
+		}
+		/* a fixed-point value has one digit at least before the point */
+		if(digits <= precision)
+		{
+			digits = precision + 1;
+		}
+	}
+	else
+	{
+		while((digits < LCD_MAX_HEX_DIGITS) && ((value >> (4 * digits)) != 0))
+		{
+			digits++;
+		}
+		precision = 0;
+	}
+	length = digits + ((precision != 0) ? 1 : 0) + ((negative == TRUE) ? 1 : 0);
+
+	/* Pad the field, leading zeros are extra digits after the sign */
+	if(pad == '0')
+	{
+		if(negative == TRUE)
+		{
+			LCD_displayCharacter('-');
+		}
+		for(; length < width; length++)
+		{
+			digits++;
+		}
+	}
+	else
+	{
+		for(; length < width; length++)
+		{
+			LCD_displayCharacter(' ');
+		}
+		if(negative == TRUE)
+		{
+			LCD_displayCharacter('-');
+		}
+	}
+
+	/* Display the digits from the most significant one */
+	for(i = digits - 1; i >= 0; i--)
+	{
+		if(base == 10)
+		{
+			digit = 0;
+			if(i < LCD_MAX_DECIMAL_DIGITS)
+			{
+				/* at most 9 subtractions per digit instead of a 32-bit division */
+				power = pgm_read_dword(&g_powersOf10[i]);
+				while(value >= power)
+				{
+					value -= power;
+					digit++;
+				}
+			}
+			if((precision != 0) && (i == (sint8)(precision - 1)))
+			{
+				LCD_displayCharacter('.');
+			}
+			LCD_displayCharacter('0' + digit);
+		}
+		else
+		{
+			digit = (i < LCD_MAX_HEX_DIGITS) ? ((value >> (4 * i)) & 0x0F) : 0;
+			LCD_displayCharacter((digit < 10) ? ('0' + digit) : (hex_a + digit - 10));
+		}
+	}
+}
+
+static void LCD_printString(const char *Str, boolean in_flash, uint8 width)
+{
+	uint8 length = 0;
+	uint8 character;
+
+	/* the string length is needed first to right align it */
+	while(((in_flash == TRUE) ? pgm_read_byte(&Str[length]) : Str[length]) != '\0')
+	{
+		length++;
+	}
+	for(; length < width; length++)
+	{
+		LCD_displayCharacter(' ');
+	}
+	while((character = ((in_flash == TRUE) ? pgm_read_byte(Str) : *Str)) != '\0')
+	{
+		LCD_displayCharacter(character);
+		Str++;
+	}
 }
 
 /*
  * Description :
- * Send the clear screen command
+ * Display the arguments formatted by the format string stored in the flash (PROGMEM)
+ */
+void LCD_printf_P(const char *format, ...)
+{
+	va_list args;
+	uint8 character;
+	uint8 pad;
+	uint8 width;
+	uint8 precision;
+	boolean is_long;
+	uint32 value;
+	boolean negative;
+
+	va_start(args,format);
+
+	while((character = pgm_read_byte(format++)) != '\0')
+	{
+		if(character != '%')
+		{
+			LCD_displayCharacter(character);
+			continue;
+		}
+
+		/* Conversion specification: %[0][width][.precision][l]conversion */
+		pad = ' ';
+		width = 0;
+		precision = 0;
+		is_long = FALSE;
+		negative = FALSE;
+
+		character = pgm_read_byte(format++);
+		if(character == '0')
+		{
+			pad = '0';
+			character = pgm_read_byte(format++);
+		}
+		while((character >= '0') && (character <= '9'))
+		{
+			width = (width * 10) + (character - '0');
+			character = pgm_read_byte(format++);
+		}
+		if(character == '.')
+		{
+			character = pgm_read_byte(format++);
+			while((character >= '0') && (character <= '9'))
+			{
+				precision = (precision * 10) + (character - '0');
+				character = pgm_read_byte(format++);
+			}
+		}
+		if(character == 'l')
+		{
+			is_long = TRUE;
+			character = pgm_read_byte(format++);
+		}
+
+		if(character == 'd')
+		{
+			sint32 number = (is_long == TRUE) ? va_arg(args,sint32) : (sint32)va_arg(args,int);
+			if(number < 0)
+			{
+				negative = TRUE;
+				value = 0UL - (uint32)number;
+			}
+			else
+			{
+				value = (uint32)number;
+			}
+			LCD_printNumber(value,negative,10,width,precision,pad,0);
+		}
+		else if(character == 'u')
+		{
+			value = (is_long == TRUE) ? va_arg(args,uint32) : (uint32)va_arg(args,unsigned int);
+			LCD_printNumber(value,FALSE,10,width,precision,pad,0);
+		}
+		else if((character == 'x') || (character == 'X'))
+		{
+			value = (is_long == TRUE) ? va_arg(args,uint32) : (uint32)va_arg(args,unsigned int);
+			LCD_printNumber(value,FALSE,16,width,0,pad,(character == 'x') ? 'a' : 'A');
+		}
+		else if(character == 'c')
+		{
+			LCD_displayCharacter((uint8)va_arg(args,int));
+		}
+		else if(character == 's')
+		{
+			LCD_printString(va_arg(args,const char *),FALSE,width);
+		}
+		else if(character == 'S')
+		{
+			LCD_printString(va_arg(args,const char *),TRUE,width);
+		}
+		else if(character == '\0')
+		{
+			/* the format ends with a single '%' */
+			break;
+		}
+		else
+		{
+			/* "%%" or an unknown conversion, display the character itself */
+			LCD_displayCharacter(character);
+		}
+	}
+
+	va_end(args);
+}
+
+/*
+ * Description :
+ * Clear the shadow buffer, the screen is cleared on LCD_flush
  */
 void LCD_clearScreen(void)
 {
-	LCD_sendCommand(LCD_CLEAR_COMMAND); /* Send clear display command */
+	uint8 row,col;
+
+	for(row=0; row<LCD_ROWS; row++)
+	{
+		LCD_moveCursor(row,0);
+		for(col=0; col<LCD_COLS; col++)
+		{
+			LCD_displayCharacter(' ');
+		}
+	}
+	LCD_moveCursor(0,0);
+}
+
+/*
+ * Description :
+ * Send the changed cells of the shadow buffer to the screen, every run of contiguous changed
+ * cells needs one cursor command only, the cells that do not fit in the queue stay dirty
+ */
+void LCD_flush(void)
+{
+	uint8 row,col;
+	uint8 cell = 0;
+	uint8 bit;
+	uint8 address;
+
+	for(row=0; row<LCD_ROWS; row++)
+	{
+		for(col=0; col<LCD_COLS; col++, cell++)
+		{
+			/* skip 8 clean cells at once */
+			if(((cell & 7) == 0) && (g_dirty[cell >> 3] == 0))
+			{
+				col += 7;
+				cell += 7;
+				continue;
+			}
+			bit = cell & 7;
+			if(BIT_IS_CLEAR(g_dirty[cell >> 3],bit))
+			{
+				continue;
+			}
+
+			/* Move the LCD address only at the start of a run, it increments after every character */
+			address = LCD_address(row,col);
+			if(LCD_queueFree() < ((address != g_lcdAddress) ? 2 : 1))
+			{
+				/* The queue is full, the rest of the dirty cells are sent on the next call */
+				return;
+			}
+			if(address != g_lcdAddress)
+			{
+				LCD_output(LOGIC_LOW,address | LCD_SET_CURSOR_LOCATION);
+			}
+			LCD_output(LOGIC_HIGH,g_shadow[row][col]);
+			g_lcdAddress = address + 1;
+
+			CLEAR_BIT(g_dirty[cell >> 3],bit);
+		}
+	}
 }
@@ -30,6 +30,54 @@
 
 #define LCD_DATA_PORT_ID               PORTC_ID
 
+/*
+ * LCD_USE_BUSY_FLAG 1: before every write the busy flag is read back through the RW pin, so
+ *                      every command/character waits only as long as the LCD needs (~40us).
+ * LCD_USE_BUSY_FLAG 0: the RW pin may be tied to ground, every write waits the worst case
+ *                      execution time of the datasheet instead.
+ */
+#define LCD_USE_BUSY_FLAG              1
+
+/* Number of busy flag reads before the LCD is considered not responding, it bounds the wait
+   if the LCD is disconnected (a read takes about 10us at 1MHz & clear takes 1.52ms) */
+#define LCD_BUSY_POLL_LIMIT            1000
+
+/* Busy flag & address counter in the status byte */
+#define LCD_BUSY_FLAG_BIT              7
+#define LCD_ADDRESS_COUNTER_MASK       0x7F
+
+/* Worst case execution times used when the busy flag is not read */
+#define LCD_COMMAND_DELAY_US           50
+#define LCD_CLEAR_DELAY_US             2000
+
+/*
+ * LCD_ASYNC_QUEUE 1: the commands & characters go into a queue that LCD_processQueue drains
+ *                    from the system tick ISR, so LCD_flush & LCD_sendCommand never wait for
+ *                    the LCD.
+ * LCD_ASYNC_QUEUE 0: they are written to the LCD before the functions return.
+ */
+#define LCD_ASYNC_QUEUE                1
+
+/* Number of queued LCD writes, must be a power of 2 */
+#define LCD_QUEUE_SIZE                 32
+#define LCD_QUEUE_MASK                 (LCD_QUEUE_SIZE - 1)
+
+/* Maximum number of queued writes done on every tick (busy flag mode only, without the busy
+   flag one write per tick is always slower than the LCD) */
+#define LCD_QUEUE_WRITES_PER_TICK      2
+
+#if ((LCD_QUEUE_SIZE & LCD_QUEUE_MASK) != 0)
+#error "LCD_QUEUE_SIZE must be a power of 2"
+#endif
+
+/* Wait after power on before the first command */
+#define LCD_POWER_ON_DELAY_MS          15
+
+/* LCD size, the shadow buffer holds one byte per cell */
+#define LCD_ROWS                       4
+#define LCD_COLS                       16
+#define LCD_CELLS                      (LCD_ROWS * LCD_COLS)
+
 /* LCD Commands */
 #define LCD_CLEAR_COMMAND              0x01
 #define LCD_GO_TO_HOME                 0x02
@@ -38,6 +86,16 @@
 #define LCD_CURSOR_OFF                 0x0C
 #define LCD_CURSOR_ON                  0x0E
 #define LCD_SET_CURSOR_LOCATION        0x80
+#define LCD_SET_CGRAM_ADDRESS          0x40
+
+/* Custom characters: 8 CGRAM slots (character codes 0..7) of 5x8 pixels, a glyph pattern is
+   8 bytes (one per pixel row, the 5 low bits are the pixels from left to right) */
+#define LCD_GLYPH_SLOTS                8
+#define LCD_GLYPH_WIDTH                5
+#define LCD_GLYPH_HEIGHT               8
+
+/* Character of the LCD ROM with all the pixels on */
+#define LCD_FULL_BLOCK                 0xFF
 
 /*******************************************************************************
  *                      Functions Prototypes                                   *
@@ -53,16 +111,27 @@ void LCD_init(void);
 
 /*
  * Description :
- * Send the required command to the screen
+ * Send the required command to the screen (queue it in LCD_ASYNC_QUEUE mode, waiting only if
+ * the queue is full)
  */
 void LCD_sendCommand(uint8 command);
 
 /*
  * Description :
- * Display the required character on the screen
+ * Display the required character at the cursor of the shadow buffer and move the cursor to
+ * the next column, the characters after the last column are dropped.
+ * The display functions only write into the shadow buffer, the screen changes on LCD_flush.
  */
 void LCD_displayCharacter(uint8 data);
 
+/*
+ * Description :
+ * Read the status of the LCD: the busy flag in bit 7 and the address counter in bits 0..6
+ * It needs the RW pin, it returns 0 if LCD_USE_BUSY_FLAG is 0.
+ * In LCD_ASYNC_QUEUE mode it is called from the tick ISR only.
+ */
+uint8 LCD_readStatus(void);
+
 /*
  * Description :
  * Display the required string on the screen
@@ -71,7 +140,13 @@ void LCD_displayString(const char *Str);
 
 /*
  * Description :
- * Move the cursor to a specified row and column index on the screen
+ * Display the required string stored in the flash (PROGMEM) on the screen
+ */
+void LCD_displayString_P(const char *Str);
+
+/*
+ * Description :
+ * Move the cursor of the shadow buffer to a specified row and column index
  */
 void LCD_moveCursor(uint8 row,uint8 col);
 
@@ -81,6 +156,13 @@ void LCD_moveCursor(uint8 row,uint8 col);
  */
 void LCD_displayStringRowColumn(uint8 row,uint8 col,const char *Str);
 
+/*
+ * Description :
+ * Display the required string stored in the flash (PROGMEM) in a specified row and column
+ * index on the screen
+ */
+void LCD_displayStringRowColumn_P(uint8 row,uint8 col,const char *Str);
+
 /*
  * Description :
  * Display the required decimal value on the screen
@@ -89,8 +171,52 @@ void LCD_intgerToString(int data);
 
 /*
  * Description :
- * Send the clear screen command
+ * Display the arguments formatted by the format string stored in the flash (PROGMEM), the
+ * characters go directly to the shadow buffer without any intermediate buffer.
+ * Conversions: %d %u (int), %ld %lu (32-bit), %x %X %lx %lX (hex), %c, %s (string in SRAM),
+ *              %S (string in the flash) and %%.
+ * Modifiers  : "0" pads with zeros instead of spaces, a width right aligns the field and
+ *              ".n" shows a decimal integer as fixed-point with n fraction digits
+ *              (e.g. "%3.1d" with 123 shows "12.3").
+ */
+void LCD_printf_P(const char *format, ...);
+
+/*
+ * Description :
+ * Clear the shadow buffer, the screen is cleared on LCD_flush
  */
 void LCD_clearScreen(void);
 
+/*
+ * Description :
+ * Send the changed cells of the shadow buffer to the screen, every run of contiguous changed
+ * cells needs one cursor command only.
+ * In LCD_ASYNC_QUEUE mode it never waits: it queues the cells that fit in the queue and the
+ * rest stay dirty for the next call.
+ */
+void LCD_flush(void);
+
+/*
+ * Description :
+ * Return the character code (0..7) of the glyph whose pattern (LCD_GLYPH_HEIGHT bytes in the
+ * flash) is given. The glyph is uploaded to the CGRAM only if it is not already there, the
+ * least recently used glyph that is not on the screen is replaced.
+ */
+uint8 LCD_getGlyph(const uint8 *pattern);
+
+/*
+ * Description :
+ * Display a progress bar of "cells" characters in a specified row and column index, filled
+ * in proportion to value/max with a resolution of one pixel column.
+ * Only the cells that change are sent on LCD_flush.
+ */
+void LCD_displayProgressBar(uint8 row, uint8 col, uint8 cells, uint16 value, uint16 max);
+
+/*
+ * Description :
+ * Write the queued commands & characters to the LCD as long as it is not busy, it must be
+ * called every system tick (e.g. as the Timer0 Call Back) in LCD_ASYNC_QUEUE mode.
+ */
+void LCD_processQueue(void);
+
 #endif /* LCD_H_ */
@@ -0,0 +1,110 @@
+ /******************************************************************************
+ *
+ * Module: Messages
+ *
+ * File Name: messages.c
+ *
+ * Description: Source file for the table of the HMI messages stored in the flash
+ *
+ * Author: Belal Badr
+ *
+ *******************************************************************************/
+#include "messages.h"
+#include "lcd.h"
+#include <avr/pgmspace.h> /* To keep the messages in the flash */
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* The messages & the table stay in the flash, none of them is copied to the SRAM at startup */
+static const char g_msgWelcome[] PROGMEM             = "Welcome !";
+static const char g_msgProcessing[] PROGMEM          = "PROCESSING";
+static const char g_msgEnterPassword[] PROGMEM       = "Enter Password";
+static const char g_msgOf5Numbers[] PROGMEM          = "of 5 numbers !";
+static const char g_msgEnterYour[] PROGMEM           = "Enter Your";
+static const char g_msgPassword[] PROGMEM            = "Password !";
+static const char g_msgNewPassword[] PROGMEM         = "New Password !";
+static const char g_msgPleaseConfirm[] PROGMEM       = "Please Confirm";
+static const char g_msgYourPassword[] PROGMEM        = "your password !";
+static const char g_msgPasswordNot[] PROGMEM         = "Password not";
+static const char g_msgConfirmed[] PROGMEM           = "Confirmed";
+static const char g_msgPleaseReEnter[] PROGMEM       = "Please re-enter";
+static const char g_msgChanged[] PROGMEM             = "changed !";
+static const char g_msgMc2IsNot[] PROGMEM            = "MC2 is not";
+static const char g_msgResponding[] PROGMEM          = "responding !";
+static const char g_msgRequestRejected[] PROGMEM     = "Request rejected";
+static const char g_msgByMc2[] PROGMEM               = "by MC2 !";
+static const char g_msgCorrectPassword[] PROGMEM     = "Correct Password";
+static const char g_msgWrongPassword[] PROGMEM       = "Wrong Password";
+static const char g_msgWrongPasswordAlarm[] PROGMEM  = "WRONG PASSWORD";
+static const char g_msgBuzzerOn[] PROGMEM            = "BUZZER ON";
+static const char g_msgSecondsLeft[] PROGMEM         = "%2u seconds";
+static const char g_msgOpeningThe[] PROGMEM          = "Opening the";
+static const char g_msgDoor[] PROGMEM                = "Door";
+static const char g_msgMenuOpenDoor[] PROGMEM        = "+: Open the door";
+static const char g_msgMenuChangeThe[] PROGMEM       = "-: Change the";
+static const char g_msgMenuPassword[] PROGMEM        = "password";
+static const char g_msgPowerStatistics[] PROGMEM     = "Power statistics";
+static const char g_msgAverageCurrent[] PROGMEM      = "Current %4u uA";
+static const char g_msgWakeUps[] PROGMEM             = "Wake ups %5u";
+static const char g_msgWakeLatency[] PROGMEM         = "Latency %5u ms";
+
+static const char * const g_messages[MSG_COUNT] PROGMEM =
+{
+	[MSG_WELCOME]              = g_msgWelcome,
+	[MSG_PROCESSING]           = g_msgProcessing,
+	[MSG_ENTER_PASSWORD]       = g_msgEnterPassword,
+	[MSG_OF_5_NUMBERS]         = g_msgOf5Numbers,
+	[MSG_ENTER_YOUR]           = g_msgEnterYour,
+	[MSG_PASSWORD]             = g_msgPassword,
+	[MSG_NEW_PASSWORD]         = g_msgNewPassword,
+	[MSG_PLEASE_CONFIRM]       = g_msgPleaseConfirm,
+	[MSG_YOUR_PASSWORD]        = g_msgYourPassword,
+	[MSG_PASSWORD_NOT]         = g_msgPasswordNot,
+	[MSG_CONFIRMED]            = g_msgConfirmed,
+	[MSG_PLEASE_RE_ENTER]      = g_msgPleaseReEnter,
+	[MSG_CHANGED]              = g_msgChanged,
+	[MSG_MC2_IS_NOT]           = g_msgMc2IsNot,
+	[MSG_RESPONDING]           = g_msgResponding,
+	[MSG_REQUEST_REJECTED]     = g_msgRequestRejected,
+	[MSG_BY_MC2]               = g_msgByMc2,
+	[MSG_CORRECT_PASSWORD]     = g_msgCorrectPassword,
+	[MSG_WRONG_PASSWORD]       = g_msgWrongPassword,
+	[MSG_WRONG_PASSWORD_ALARM] = g_msgWrongPasswordAlarm,
+	[MSG_BUZZER_ON]            = g_msgBuzzerOn,
+	[MSG_SECONDS_LEFT]         = g_msgSecondsLeft,
+	[MSG_OPENING_THE]          = g_msgOpeningThe,
+	[MSG_DOOR]                 = g_msgDoor,
+	[MSG_MENU_OPEN_DOOR]       = g_msgMenuOpenDoor,
+	[MSG_MENU_CHANGE_THE]      = g_msgMenuChangeThe,
+	[MSG_MENU_PASSWORD]        = g_msgMenuPassword,
+	[MSG_POWER_STATISTICS]     = g_msgPowerStatistics,
+	[MSG_AVERAGE_CURRENT]      = g_msgAverageCurrent,
+	[MSG_WAKE_UPS]             = g_msgWakeUps,
+	[MSG_WAKE_LATENCY]         = g_msgWakeLatency,
+};
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+const char * MESSAGES_get(MESSAGES_IdType id)
+{
+	if(id >= MSG_COUNT)
+	{
+		return NULL_PTR;
+	}
+	/* The table itself is in the flash, so the address of the message is read from there */
+	return (const char *)pgm_read_word(&g_messages[id]);
+}
+
+void MESSAGES_display(uint8 row, uint8 col, MESSAGES_IdType id)
+{
+	const char *message = MESSAGES_get(id);
+
+	if(message != NULL_PTR)
+	{
+		LCD_displayStringRowColumn_P(row,col,message);
+	}
+}
@@ -0,0 +1,76 @@
+ /******************************************************************************
+ *
+ * Module: Messages
+ *
+ * File Name: messages.h
+ *
+ * Description: Header file for the table of the HMI messages stored in the flash
+ *
+ * Author: Belal Badr
+ *
+ *******************************************************************************/
+
+#ifndef MESSAGES_H_
+#define MESSAGES_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* One id per message, every message fits in one LCD row */
+typedef enum
+{
+	MSG_WELCOME,
+	MSG_PROCESSING,
+	MSG_ENTER_PASSWORD,
+	MSG_OF_5_NUMBERS,
+	MSG_ENTER_YOUR,
+	MSG_PASSWORD,
+	MSG_NEW_PASSWORD,
+	MSG_PLEASE_CONFIRM,
+	MSG_YOUR_PASSWORD,
+	MSG_PASSWORD_NOT,
+	MSG_CONFIRMED,
+	MSG_PLEASE_RE_ENTER,
+	MSG_CHANGED,
+	MSG_MC2_IS_NOT,
+	MSG_RESPONDING,
+	MSG_REQUEST_REJECTED,
+	MSG_BY_MC2,
+	MSG_CORRECT_PASSWORD,
+	MSG_WRONG_PASSWORD,
+	MSG_WRONG_PASSWORD_ALARM,
+	MSG_BUZZER_ON,
+	MSG_SECONDS_LEFT,     /* LCD_printf_P format, the argument is the number of seconds */
+	MSG_OPENING_THE,
+	MSG_DOOR,
+	MSG_MENU_OPEN_DOOR,
+	MSG_MENU_CHANGE_THE,
+	MSG_MENU_PASSWORD,
+	MSG_POWER_STATISTICS,
+	MSG_AVERAGE_CURRENT,  /* LCD_printf_P format, the argument is the current in micro-amperes */
+	MSG_WAKE_UPS,         /* LCD_printf_P format, the argument is the number of wake ups */
+	MSG_WAKE_LATENCY,     /* LCD_printf_P format, the argument is the latency in milli-seconds */
+	MSG_COUNT
+}MESSAGES_IdType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Return the address of the message in the flash, to be read with pgm_read_byte or
+ * displayed with LCD_displayString_P
+ */
+const char * MESSAGES_get(MESSAGES_IdType id);
+
+/*
+ * Description :
+ * Display the message in a specified row and column index on the screen
+ */
+void MESSAGES_display(uint8 row, uint8 col, MESSAGES_IdType id);
+
+#endif /* MESSAGES_H_ */
@@ -0,0 +1,201 @@
+ /******************************************************************************
+ *
+ * Module: Power
+ *
+ * File Name: power.c
+ *
+ * Description: Source file for the low power idle of MC1
+ *
+ * Author: Belal Badr
+ *
+ *******************************************************************************/
+#include "power.h"
+#include "keypad.h"
+#include "timer.h" /* For the Timer0 counts of a system tick */
+#include <avr/io.h> /* To use the SREG Register */
+#include <avr/sleep.h> /* To use the sleep mode functions */
+#include <avr/interrupt.h> /* For sei just before sleeping */
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Value of the wake up ticks counter while no wake up is measured */
+#define POWER_NO_WAKE_UP                 (0xFFFF)
+
+/* Limit of the awake + sleep ticks used in the average current, so the products fit in 32 bits */
+#define POWER_MAX_SAMPLES                (0x000FFFFFUL)
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* System ticks since POWER_init, written by the tick ISR only */
+static volatile uint32 g_ticks = 0;
+
+/* Time slept in milli-seconds & the Timer0 counts of the last partial milli-second, written
+   by POWER_idle only */
+static uint32 g_sleepMs = 0;
+static uint16 g_sleepCounts = 0;
+
+/* Instrumentation counters, written by the tick ISR only */
+static volatile uint16 g_wakeups = 0;
+static volatile uint16 g_wakeLatency = 0;
+
+/* Standby state, used from the tick ISR only */
+static uint16 g_idleTicks = 0;
+static uint16 g_wakeTicks = POWER_NO_WAKE_UP;
+static boolean g_keypadStandby = FALSE;
+
+/* Called from the tick ISR when a key wakes the keypad up */
+static void (*volatile g_wakeCallBackPtr)(void) = NULL_PTR;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+void POWER_init(void)
+{
+	g_ticks = 0;
+	g_sleepMs = 0;
+	g_sleepCounts = 0;
+	g_wakeups = 0;
+	g_wakeLatency = 0;
+	g_idleTicks = 0;
+	g_wakeTicks = POWER_NO_WAKE_UP;
+	g_keypadStandby = FALSE;
+
+	set_sleep_mode(SLEEP_MODE_IDLE);
+}
+
+void POWER_idle(void)
+{
+	/* Called with the interrupts disabled, so the tick & its count are read together. A
+	   compare match already pending wakes the CPU up at once, this sleep is not counted */
+	uint32 ticks = g_ticks;
+	uint8 start = TCNT0;
+	boolean tick_pending = (TIFR & (1<<OCF0)) ? TRUE : FALSE;
+
+	sleep_enable();
+
+	/* The instruction after sei is always executed before any pending interrupt, so an event
+	   posted from now on wakes the CPU up from this sleep instead of being missed before it */
+	sei();
+	sleep_cpu();
+
+	sleep_disable();
+
+	SREG &= ~(1<<7);
+	if(tick_pending == FALSE)
+	{
+		if(g_ticks != ticks)
+		{
+			/* The tick woke the CPU up, it slept until the compare match of this tick */
+			g_sleepCounts += (uint16)(TIMER_TICK_COUNTS - start);
+		}
+		else
+		{
+			/* Another interrupt (e.g. the UART) woke it up, its short ISR is counted as sleep */
+			g_sleepCounts += (uint8)(TCNT0 - start);
+		}
+
+		while(g_sleepCounts >= TIMER_TICK_COUNTS)
+		{
+			g_sleepCounts -= TIMER_TICK_COUNTS;
+			g_sleepMs++;
+		}
+	}
+}
+
+void POWER_tick(void)
+{
+	g_ticks++;
+
+	if(KEYPAD_isStandby())
+	{
+		g_keypadStandby = TRUE;
+		return;
+	}
+
+	if(g_keypadStandby)
+	{
+		/* A key has just woken the keypad up, measure the time until its press is debounced */
+		g_keypadStandby = FALSE;
+		g_wakeups++;
+		g_wakeTicks = 0;
+		g_idleTicks = 0;
+		if(g_wakeCallBackPtr != NULL_PTR)
+		{
+			(*g_wakeCallBackPtr)();
+		}
+	}
+
+	if(KEYPAD_getKeysState() != 0)
+	{
+		g_idleTicks = 0;
+		if(g_wakeTicks != POWER_NO_WAKE_UP)
+		{
+			g_wakeLatency = g_wakeTicks;
+			g_wakeTicks = POWER_NO_WAKE_UP;
+		}
+	}
+	else
+	{
+		if(g_wakeTicks != POWER_NO_WAKE_UP)
+		{
+			g_wakeTicks++;
+		}
+
+		g_idleTicks++;
+		if(g_idleTicks >= POWER_STANDBY_MS)
+		{
+			/* Nobody is at the door, a wake up without any press is not measured */
+			g_idleTicks = 0;
+			g_wakeTicks = POWER_NO_WAKE_UP;
+			g_keypadStandby = KEYPAD_standby();
+		}
+	}
+}
+
+void POWER_setWakeCallBack(void(*a_ptr)(void))
+{
+	/* Save the address of the Call back function in a global variable */
+	g_wakeCallBackPtr = a_ptr;
+}
+
+void POWER_getStats(POWER_StatsType *stats)
+{
+	uint32 ticks;
+	uint32 awake;
+	uint32 sleep;
+	uint8 sreg = SREG;
+
+	/* The counters are written by the tick ISR, read them with the interrupts disabled */
+	SREG &= ~(1<<7);
+	ticks = g_ticks;
+	stats->wakeups = g_wakeups;
+	stats->wake_latency_ms = g_wakeLatency;
+	SREG = sreg;
+
+	/* Every tick is 1 ms, the time slept is counted by POWER_idle in the main loop */
+	stats->sleep_ms = g_sleepMs;
+	stats->awake_ms = (ticks > g_sleepMs) ? (ticks - g_sleepMs) : 0;
+
+	awake = stats->awake_ms;
+	sleep = stats->sleep_ms;
+	while((awake + sleep) > POWER_MAX_SAMPLES)
+	{
+		awake >>= 1;
+		sleep >>= 1;
+	}
+
+	if((awake + sleep) == 0)
+	{
+		stats->average_current_ua = POWER_ACTIVE_CURRENT_UA;
+	}
+	else
+	{
+		stats->average_current_ua = POWER_IDLE_CURRENT_UA +
+			(uint16)(((uint32)(POWER_ACTIVE_CURRENT_UA - POWER_IDLE_CURRENT_UA) * awake) / (awake + sleep));
+	}
+}
@@ -0,0 +1,85 @@
+ /******************************************************************************
+ *
+ * Module: Power
+ *
+ * File Name: power.h
+ *
+ * Description: Header file for the low power idle of MC1
+ *
+ * Author: Belal Badr
+ *
+ *******************************************************************************/
+
+#ifndef POWER_H_
+#define POWER_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Time without any key pressed before the keypad is put in standby, in system ticks (ms) */
+#define POWER_STANDBY_MS                 5000
+
+/* Supply current of the MCU while it runs & while it sleeps in idle mode, in micro-amperes,
+   used to estimate the average current (ATmega16L at 1 MHz, 3 V) */
+#define POWER_ACTIVE_CURRENT_UA          1100
+#define POWER_IDLE_CURRENT_UA            350
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+typedef struct
+{
+	uint32 awake_ms;            /* time the CPU was running the main loop & the ISRs */
+	uint32 sleep_ms;            /* time the CPU slept, measured on the Timer0 counts */
+	uint16 wakeups;             /* number of times a key woke the keypad up from standby */
+	uint16 wake_latency_ms;     /* ticks from the last wake up to its debounced key press */
+	uint16 average_current_ua;  /* estimated from the awake & sleep times */
+}POWER_StatsType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Select the idle sleep mode & clear the statistics.
+ */
+void POWER_init(void);
+
+/*
+ * Description :
+ * Sleep until the next interrupt, it is the idle Call Back of the scheduler so it is called
+ * with the interrupts disabled & only when no event is queued.
+ * The idle mode keeps the timers & the UART running, so the system tick wakes the CPU up
+ * every milli-second at most.
+ * The time slept is measured from the Timer0 count when the CPU goes to sleep until the
+ * compare match that wakes it up, so the run time of the tick ISR is counted as awake.
+ */
+void POWER_idle(void);
+
+/*
+ * Description :
+ * Count the system ticks, put the keypad in standby after POWER_STANDBY_MS without any key
+ * pressed & measure the wake up latency. It must be called every system tick from the tick
+ * ISR, after KEYPAD_tick.
+ */
+void POWER_tick(void);
+
+/*
+ * Description :
+ * Set the Call Back function called from the tick ISR when a key wakes the keypad up from
+ * standby (e.g. to restart the polling stopped during the standby).
+ */
+void POWER_setWakeCallBack(void(*a_ptr)(void));
+
+/*
+ * Description :
+ * Copy the instrumentation counters & the estimated average current in "stats", they are
+ * shown on the service screen of the main menu ('=' key).
+ */
+void POWER_getStats(POWER_StatsType *stats);
+
+#endif /* POWER_H_ */
@@ -16,7 +16,53 @@
 
 Timer_ConfigType TIMER0_config; /* Declaring a global variable for Timer0 configuration */
 
-static volatile void (*g_callBackPtr)(void) = NULL_PTR;
+static void (*volatile g_callBackPtr)(void) = NULL_PTR;
+
+/* Milli-seconds elapsed since Timer_initSystemTick, incremented by the compare match ISR only */
+static volatile uint32 g_millis = 0;
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Index used to terminate the wheel lists */
+#define TIMER_NO_TIMER            (0xFF)
+
+/* Slot value of a timer that is not in the wheel */
+#define TIMER_INACTIVE            (0xFF)
+#define TIMER_EXPIRED             (0xFE)
+
+typedef struct
+{
+	void (*callBack)(void);
+	uint16 rounds; /* number of wheel turns left before it expires */
+	uint8 slot;    /* wheel slot or TIMER_INACTIVE/TIMER_EXPIRED */
+	uint8 next;
+	uint8 prev;
+}Timer_SoftTimerType;
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Software timers & the doubly linked list of timers hashed into each wheel slot */
+static Timer_SoftTimerType g_timers[TIMER_MAX_SOFT_TIMERS];
+static uint8 g_wheel[TIMER_WHEEL_SLOTS];
+static uint8 g_wheelPosition = 0;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+/*
+ * Unlink the timer "id" from its wheel slot, called with the interrupts disabled.
+ */
+static void Timer_unlink(uint8 id);
+
+/*
+ * Visit the next wheel slot and call the call-back of every timer that expires, called every tick.
+ */
+static void Timer_processWheel(void);
 
 /*******************************************************************************
  *                      Functions Definitions                                  *
@@ -33,6 +79,9 @@ ISR(TIMER0_OVF_vect)
 
 ISR(TIMER0_COMP_vect)
 {
+	/* One system tick has elapsed */
+	g_millis++;
+	Timer_processWheel();
 
 	if(g_callBackPtr != NULL_PTR)
 	{
@@ -45,7 +94,6 @@ void Timer0_Init(const Timer_ConfigType * Config_Ptr)
 {
 	TCNT0 = ( Config_Ptr->initial_value);  // Set Initial Value to 0
 	TCCR0 = (1<<FOC0) | ((Config_Ptr->clock & 0x07) | (TCCR0 & 0XF8));
-	 SREG |=(1<<7); //Enable interrupts
 	if ((Config_Ptr->mode) == CTC )
 	{
 		OCR0 = (Config_Ptr->compare_value); // Set Compare Value
@@ -78,7 +126,191 @@ void Timer_DeInit(void)
 	OCR0=0;
 	/* Disable Timers interrupt */
 	TIMSK &= ~(1<<TOIE0) & ~(1<<OCIE0);
-	SREG &=~(1<<7);
 
 	g_callBackPtr = NULL_PTR; /* clear the call-back function */
 }
+
+void Timer_initSystemTick(void)
+{
+	uint8 i;
+
+	/* No software timer is running at the beginning */
+	for(i=0; i<TIMER_WHEEL_SLOTS; i++)
+	{
+		g_wheel[i] = TIMER_NO_TIMER;
+	}
+	for(i=0; i<TIMER_MAX_SOFT_TIMERS; i++)
+	{
+		g_timers[i].slot = TIMER_INACTIVE;
+	}
+	g_wheelPosition = 0;
+
+	/* Setting up Timer0 in CTC mode to interrupt every 1 ms */
+	TIMER0_config.clock = TIMER_TICK_PRESCALER;
+	TIMER0_config.compare_value = TIMER_TICK_COMPARE_VALUE;
+	TIMER0_config.initial_value = 0;
+	TIMER0_config.mode = CTC;
+
+	g_millis = 0;
+	Timer0_Init(&TIMER0_config);
+}
+
+uint32 Timer_millis(void)
+{
+	uint32 millis;
+	uint8 sreg = SREG;
+
+	/* The 32-bit counter takes four reads, so read it with the tick interrupt masked */
+	SREG &= ~(1<<7);
+	millis = g_millis;
+	SREG = sreg;
+
+	return millis;
+}
+
+uint32 Timer_deadline(uint32 m_seconds)
+{
+	return Timer_millis() + m_seconds;
+}
+
+boolean Timer_isExpired(uint32 deadline)
+{
+	/* The signed difference keeps working when the counter wraps around */
+	return ((sint32)(Timer_millis() - deadline) >= 0) ? TRUE : FALSE;
+}
+
+void Timer_delayMs(uint32 m_seconds)
+{
+	uint32 deadline = Timer_deadline(m_seconds);
+
+	while(Timer_isExpired(deadline) == FALSE){}
+}
+
+static void Timer_unlink(uint8 id)
+{
+	Timer_SoftTimerType *timer = &g_timers[id];
+
+	if(timer->prev == TIMER_NO_TIMER)
+	{
+		g_wheel[timer->slot] = timer->next;
+	}
+	else
+	{
+		g_timers[timer->prev].next = timer->next;
+	}
+	if(timer->next != TIMER_NO_TIMER)
+	{
+		g_timers[timer->next].prev = timer->prev;
+	}
+	timer->slot = TIMER_INACTIVE;
+}
+
+static void Timer_processWheel(void)
+{
+	uint8 id;
+	uint8 next;
+	uint8 expired = 0; /* bit per expired timer */
+
+	g_wheelPosition = (g_wheelPosition + 1) & TIMER_WHEEL_MASK;
+
+	/* Only the timers hashed into this slot can expire on this tick */
+	for(id = g_wheel[g_wheelPosition]; id != TIMER_NO_TIMER; id = next)
+	{
+		next = g_timers[id].next;
+		if(g_timers[id].rounds == 0)
+		{
+			Timer_unlink(id);
+			g_timers[id].slot = TIMER_EXPIRED;
+			expired |= (1<<id);
+		}
+		else
+		{
+			g_timers[id].rounds--;
+		}
+	}
+
+	/* Call the call-backs after walking the slot, so they are free to start or cancel timers */
+	for(id = 0; expired != 0; id++, expired >>= 1)
+	{
+		if((expired & 1) && (g_timers[id].slot == TIMER_EXPIRED))
+		{
+			g_timers[id].slot = TIMER_INACTIVE;
+			(*g_timers[id].callBack)();
+		}
+	}
+}
+
+void Timer_start(uint8 id, uint16 m_seconds, void(*a_ptr)(void))
+{
+	Timer_SoftTimerType *timer;
+	uint8 sreg = SREG;
+
+	if((id >= TIMER_MAX_SOFT_TIMERS) || (a_ptr == NULL_PTR))
+	{
+		return;
+	}
+	if(m_seconds == 0)
+	{
+		m_seconds = 1;
+	}
+	timer = &g_timers[id];
+
+	/* The wheel is also changed by the tick ISR */
+	SREG &= ~(1<<7);
+
+	if((timer->slot != TIMER_INACTIVE) && (timer->slot != TIMER_EXPIRED))
+	{
+		Timer_unlink(id);
+	}
+
+	/* The slot is visited first after ((m_seconds - 1) % TIMER_WHEEL_SLOTS) + 1 ticks then
+	   every TIMER_WHEEL_SLOTS ticks */
+	timer->callBack = a_ptr;
+	timer->rounds = (m_seconds - 1) >> TIMER_WHEEL_SHIFT;
+	timer->slot = (g_wheelPosition + m_seconds) & TIMER_WHEEL_MASK;
+
+	/* Insert at the head of the slot list */
+	timer->prev = TIMER_NO_TIMER;
+	timer->next = g_wheel[timer->slot];
+	if(timer->next != TIMER_NO_TIMER)
+	{
+		g_timers[timer->next].prev = id;
+	}
+	g_wheel[timer->slot] = id;
+
+	SREG = sreg;
+}
+
+void Timer_cancel(uint8 id)
+{
+	uint8 sreg = SREG;
+
+	if(id >= TIMER_MAX_SOFT_TIMERS)
+	{
+		return;
+	}
+
+	SREG &= ~(1<<7);
+
+	if(g_timers[id].slot == TIMER_EXPIRED)
+	{
+		/* Expired on this tick but its call-back has not been called yet */
+		g_timers[id].slot = TIMER_INACTIVE;
+	}
+	else if(g_timers[id].slot != TIMER_INACTIVE)
+	{
+		Timer_unlink(id);
+	}
+
+	SREG = sreg;
+}
+
+boolean Timer_isRunning(uint8 id)
+{
+	if(id >= TIMER_MAX_SOFT_TIMERS)
+	{
+		return FALSE;
+	}
+	/* An expired timer waiting for its call-back is not running any more */
+	return ((g_timers[id].slot != TIMER_INACTIVE) && (g_timers[id].slot != TIMER_EXPIRED)) ? TRUE : FALSE;
+}
@@ -10,6 +10,9 @@
  *
  *******************************************************************************/
 
+#ifndef TIMER_H_
+#define TIMER_H_
+
 #include "std_types.h"
 
 
@@ -31,6 +34,67 @@ typedef struct
 	uint16  compare_value;
 }Timer_ConfigType;
 
+/*
+ * System tick configuration: Timer0 in CTC mode at TIMER_TICK_HZ.
+ * The prescaler and the compare value are derived from F_CPU at compile time, the smallest
+ * prescaler that fits the 8-bit OCR0 is used to get the best resolution.
+ * (1 MHz: F_CPU/8 & OCR0 = 124, 8 MHz: F_CPU/64 & OCR0 = 124, 16 MHz: F_CPU/64 & OCR0 = 249)
+ */
+#ifndef F_CPU
+#error "F_CPU must be defined"
+#endif
+
+#define TIMER_TICK_HZ                 1000UL
+
+/* Maximum accepted error of the system tick in per mille */
+#define TIMER_TICK_MAX_ERROR          5UL
+
+#if ((F_CPU / TIMER_TICK_HZ) <= 256UL)
+#define TIMER_TICK_PRESCALER          F_CPU_CLOCK
+#define TIMER_TICK_DIVIDER            1UL
+#elif ((F_CPU / 8UL / TIMER_TICK_HZ) <= 256UL)
+#define TIMER_TICK_PRESCALER          F_CPU_8
+#define TIMER_TICK_DIVIDER            8UL
+#elif ((F_CPU / 64UL / TIMER_TICK_HZ) <= 256UL)
+#define TIMER_TICK_PRESCALER          F_CPU_64
+#define TIMER_TICK_DIVIDER            64UL
+#elif ((F_CPU / 256UL / TIMER_TICK_HZ) <= 256UL)
+#define TIMER_TICK_PRESCALER          F_CPU_256
+#define TIMER_TICK_DIVIDER            256UL
+#else
+#define TIMER_TICK_PRESCALER          F_CPU_1024
+#define TIMER_TICK_DIVIDER            1024UL
+#endif
+
+/* Timer counts per tick rounded to the nearest count */
+#define TIMER_TICK_COUNTS             ((F_CPU + ((TIMER_TICK_DIVIDER * TIMER_TICK_HZ) / 2UL)) / (TIMER_TICK_DIVIDER * TIMER_TICK_HZ))
+#define TIMER_TICK_COMPARE_VALUE      (TIMER_TICK_COUNTS - 1UL)
+
+/* CPU cycles counted by TIMER_TICK_HZ ticks, it equals F_CPU when the tick is exact */
+#define TIMER_TICK_CYCLES_PER_SECOND  (TIMER_TICK_COUNTS * TIMER_TICK_DIVIDER * TIMER_TICK_HZ)
+
+#if (TIMER_TICK_COUNTS > 256UL) || (TIMER_TICK_COUNTS < 2UL)
+#error "The system tick can not be generated from this F_CPU"
+#endif
+
+/*
+ * Software timers configuration.
+ * Up to TIMER_MAX_SOFT_TIMERS timers (ids 0 .. TIMER_MAX_SOFT_TIMERS-1) run on the system tick
+ * through a hashed timer wheel of TIMER_WHEEL_SLOTS slots, one slot is visited per tick.
+ */
+#define TIMER_MAX_SOFT_TIMERS         8
+#define TIMER_WHEEL_SHIFT             3
+#define TIMER_WHEEL_SLOTS             (1 << TIMER_WHEEL_SHIFT)
+#define TIMER_WHEEL_MASK              (TIMER_WHEEL_SLOTS - 1)
+
+#if (TIMER_MAX_SOFT_TIMERS > 8)
+#error "TIMER_MAX_SOFT_TIMERS must not be above 8"
+#endif
+
+#if ((((TIMER_TICK_CYCLES_PER_SECOND > F_CPU) ? (TIMER_TICK_CYCLES_PER_SECOND - F_CPU) : (F_CPU - TIMER_TICK_CYCLES_PER_SECOND)) * 1000UL) > (TIMER_TICK_MAX_ERROR * F_CPU))
+#error "The system tick error is above TIMER_TICK_MAX_ERROR for this F_CPU"
+#endif
+
 
 /*******************************************************************************
  *                      Functions Prototypes                                   *
@@ -40,9 +104,9 @@ typedef struct
  * Description :
  * Functional responsible for Initialize Timer0 by:
  * 1. Setup the timer mode (compare/normal).
- * 2. Enable the I-bit.
- * 3. Set up the timer prescalar number.
- * 4. setup the initial value for normal mode / compare value for CTC mode
+ * 2. Set up the timer prescalar number.
+ * 3. setup the initial value for normal mode / compare value for CTC mode
+ * It does not touch the I-bit, the application enables the interrupts once.
  */
 void Timer0_Init(const Timer_ConfigType * Config_Ptr);
 
@@ -50,6 +114,7 @@ void Timer0_Init(const Timer_ConfigType * Config_Ptr);
 /*
  * Description :
  * Functional responsible to set up the callback function for the timer.
+ * With the system tick running it is called every 1 ms from the ISR.
  */
 void Timer0_setCallBack(void(*a_ptr)(void));
 
@@ -58,3 +123,56 @@ void Timer0_setCallBack(void(*a_ptr)(void));
  * Functional that stops the timer after using it.
  */
 void Timer_DeInit(void);
+
+/*
+ * Description :
+ * Start Timer0 as the always running 1 ms system tick (CTC mode).
+ * It is called once at startup, all the delays & timeouts are built on it.
+ */
+void Timer_initSystemTick(void);
+
+/*
+ * Description :
+ * Return the number of milli-seconds elapsed since the system tick has been started.
+ */
+uint32 Timer_millis(void);
+
+/*
+ * Description :
+ * Return the deadline that expires after the required milli-seconds from now.
+ */
+uint32 Timer_deadline(uint32 m_seconds);
+
+/*
+ * Description :
+ * Return TRUE if the deadline returned by Timer_deadline has been reached.
+ */
+boolean Timer_isExpired(uint32 deadline);
+
+/*
+ * Description :
+ * Wait for the required milli-seconds on the system tick.
+ */
+void Timer_delayMs(uint32 m_seconds);
+
+/*
+ * Description :
+ * Start (or restart) the software timer "id" to call the call-back function once after the
+ * required milli-seconds (1 .. 65535). The call-back is called from the system tick ISR so it
+ * must be short. It takes O(1) whatever the number of running timers.
+ */
+void Timer_start(uint8 id, uint16 m_seconds, void(*a_ptr)(void));
+
+/*
+ * Description :
+ * Stop the software timer "id" if it is running, its call-back will not be called. It takes O(1).
+ */
+void Timer_cancel(uint8 id);
+
+/*
+ * Description :
+ * Return TRUE if the software timer "id" is running.
+ */
+boolean Timer_isRunning(uint8 id);
+
+#endif /* TIMER_H_ */
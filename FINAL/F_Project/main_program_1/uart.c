@@ -11,10 +11,77 @@
  *******************************************************************************/
 #include "uart.h"
 #include "avr/io.h" /* To use the UART Registers */
+#include "avr/interrupt.h" /* For the USART RXC & UDRE ISRs */
 #include "common_macros.h" /* To use the macros like SET_BIT */
 
 UART_ConfigType UART_config; /* Declaring a global variable for UART configuration */
 
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/*
+ * RX & TX ring buffers.
+ * Each buffer has a single producer and a single consumer (the ISR on one side and
+ * the application on the other side), and the head/tail indices are one byte wide so
+ * they are read & written atomically on the AVR. That is why no critical sections are
+ * needed to access them.
+ */
+static volatile uint8 g_rxBuffer[UART_RX_BUFFER_SIZE];
+static volatile uint8 g_rxHead = 0; /* written by the RXC ISR only */
+static volatile uint8 g_rxTail = 0; /* written by the application only */
+
+static volatile uint8 g_txBuffer[UART_TX_BUFFER_SIZE];
+static volatile uint8 g_txHead = 0; /* written by the application only */
+static volatile uint8 g_txTail = 0; /* written by the UDRE ISR only */
+
+/* Number of received bytes dropped because the RX buffer was full */
+static volatile uint8 g_rxOverflowCount = 0;
+
+/* Optional receive hook, when set the received bytes are handed to it instead of the RX buffer */
+static void (*volatile g_rxCallBackPtr)(uint8 data) = NULL_PTR;
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+ISR(USART_RXC_vect)
+{
+	/* Read UDR first to clear the RXC flag even if the byte is going to be dropped */
+	uint8 data = UDR;
+	uint8 next_head = (g_rxHead + 1) & UART_RX_BUFFER_MASK;
+
+	if(g_rxCallBackPtr != NULL_PTR)
+	{
+		/* Hand the byte directly to the receiver (e.g. a frame parser) */
+		(*g_rxCallBackPtr)(data);
+	}
+	else if(next_head == g_rxTail)
+	{
+		/* RX buffer is full, drop the byte */
+		g_rxOverflowCount++;
+	}
+	else
+	{
+		g_rxBuffer[g_rxHead] = data;
+		g_rxHead = next_head;
+	}
+}
+
+ISR(USART_UDRE_vect)
+{
+	if(g_txTail == g_txHead)
+	{
+		/* Nothing left to send, disable the UDRE interrupt until new data is queued */
+		CLEAR_BIT(UCSRB,UDRIE);
+	}
+	else
+	{
+		UDR = g_txBuffer[g_txTail];
+		g_txTail = (g_txTail + 1) & UART_TX_BUFFER_MASK;
+	}
+}
+
 /*******************************************************************************
  *                      Functions Definitions                                  *
  *******************************************************************************/
@@ -23,27 +90,33 @@ UART_ConfigType UART_config; /* Declaring a global variable for UART configurati
  * Description :
  * Functional responsible for Initialize the UART device by:
  * 1. Setup the Frame format like number of data bits, parity bit type and number of stop bits.
- * 2. Enable the UART.
- * 3. Setup the UART baud rate.
+ * 2. Enable the UART and its RX Complete interrupt.
+ * 3. Setup the UART baud rate (UART_BAUD_RATE) from the compile time UBRR value.
+ * The ring buffers are served by the ISRs once the application enables the I-bit.
  */
 void UART_init(const UART_ConfigType * Config_Ptr)
 {
-	uint16 ubrr_value = 0;
+	/* Reset the ring buffers */
+	g_rxHead = 0;
+	g_rxTail = 0;
+	g_txHead = 0;
+	g_txTail = 0;
+	g_rxOverflowCount = 0;
 
 	/* U2X = 1 for double transmission speed */
 	UCSRA = (1<<U2X);
 
 	/************************** UCSRB Description **************************
-	 * RXCIE = 0 Disable USART RX Complete Interrupt Enable
+	 * RXCIE = 1 Enable USART RX Complete Interrupt Enable
 	 * TXCIE = 0 Disable USART Tx Complete Interrupt Enable
-	 * UDRIE = 0 Disable USART Data Register Empty Interrupt Enable
+	 * UDRIE = 0 Disable USART Data Register Empty Interrupt Enable (enabled when data is queued)
 	 * RXEN  = 1 Receiver Enable
 	 * RXEN  = 1 Transmitter Enable
 	 * UCSZ2 = 0 For 8-bit data mode
 	 * RXB8 & TXB8 not used for 8-bit data mode
-	 ***********************************************************************/ 
-	UCSRB = (1<<RXEN) | (1<<TXEN);
-	
+	 ***********************************************************************/
+	UCSRB = (1<<RXCIE) | (1<<RXEN) | (1<<TXEN);
+
 	/************************** UCSRC Description **************************
 	 * URSEL   = 1 The URSEL must be one when writing the UCSRC
 	 * UMSEL   = 0 Asynchronous Operation
@@ -51,7 +124,7 @@ void UART_init(const UART_ConfigType * Config_Ptr)
 	 * USBS    = 0 One stop bit
 	 * UCSZ1:0 = 11 For 8-bit data mode
 	 * UCPOL   = 0 Used with the Synchronous operation only
-	 ***********************************************************************/ 	
+	 ***********************************************************************/
 	UCSRC = (1<<URSEL);
 	UCSRC= (((Config_Ptr->Parity)<<4 ) | (UCSRC & 0xCF));
 	if(Config_Ptr->Bits_Number == _9_BITS)
@@ -62,54 +135,112 @@ void UART_init(const UART_ConfigType * Config_Ptr)
 	UCSRC= (((Config_Ptr->Stop_Bits_Number)<<3) | (UCSRC & 0XF7 ));
 
 
-	/* Calculate the UBRR register value */
-	ubrr_value = (uint16)(((F_CPU / (Config_Ptr->Baud_Rate * 8UL))) - 1);
+	/* First 8 bits from the BAUD_PRESCALE inside UBRRL and last 4 bits in UBRRH*/
+	UBRRH = (uint8)(UART_UBRR_VALUE>>8);
+	UBRRL = (uint8)UART_UBRR_VALUE;
+}
 
+/*
+ * Description :
+ * Queue up to "length" bytes for transmission without blocking.
+ * Returns the number of bytes queued, which is less than "length" if the TX buffer is full.
+ */
+uint8 UART_write(const uint8 *data, uint8 length)
+{
+	uint8 count = 0;
+	uint8 next_head;
 
-	/* First 8 bits from the BAUD_PRESCALE inside UBRRL and last 4 bits in UBRRH*/
-	UBRRH = ubrr_value>>8;
-	UBRRL = ubrr_value;
+	while(count < length)
+	{
+		next_head = (g_txHead + 1) & UART_TX_BUFFER_MASK;
+		if(next_head == g_txTail)
+		{
+			/* TX buffer is full */
+			break;
+		}
+		g_txBuffer[g_txHead] = data[count];
+		g_txHead = next_head;
+		count++;
+	}
+
+	if(count != 0)
+	{
+		/* Kick the UDRE interrupt, it will be disabled again once the buffer is drained */
+		SET_BIT(UCSRB,UDRIE);
+	}
+
+	return count;
+}
+
+/*
+ * Description :
+ * Copy up to "length" received bytes into "data" without blocking.
+ * Returns the number of bytes copied, zero if nothing has been received.
+ */
+uint8 UART_read(uint8 *data, uint8 length)
+{
+	uint8 count = 0;
+
+	while((count < length) && (g_rxTail != g_rxHead))
+	{
+		data[count] = g_rxBuffer[g_rxTail];
+		g_rxTail = (g_rxTail + 1) & UART_RX_BUFFER_MASK;
+		count++;
+	}
+
+	return count;
+}
+
+/*
+ * Description :
+ * Return the number of received bytes waiting in the RX buffer.
+ */
+uint8 UART_available(void)
+{
+	return (g_rxHead - g_rxTail) & UART_RX_BUFFER_MASK;
+}
+
+/*
+ * Description :
+ * Return the number of received bytes dropped since UART_init because the RX buffer was full.
+ */
+uint8 UART_getOverflowCount(void)
+{
+	return g_rxOverflowCount;
+}
+
+/*
+ * Description :
+ * Set the function to be called from the RX Complete ISR with every received byte.
+ * While it is set the RX buffer is bypassed, pass NULL_PTR to return to the RX buffer.
+ */
+void UART_setRxCallBack(void(*a_ptr)(uint8 data))
+{
+	g_rxCallBackPtr = a_ptr;
 }
 
 /*
  * Description :
  * Functional responsible for send byte to another UART device.
+ * Blocking wrapper over UART_write, it waits only while the TX buffer is full.
  */
 void UART_sendByte(const uint8 data)
 {
-	/*
-	 * UDRE flag is set when the Tx buffer (UDR) is empty and ready for
-	 * transmitting a new byte so wait until this flag is set to one
-	 */
-	while(BIT_IS_CLEAR(UCSRA,UDRE)){}
-
-	/*
-	 * Put the required data in the UDR register and it also clear the UDRE flag as
-	 * the UDR register is not empty now
-	 */
-	UDR = data;
-
-	/************************* Another Method *************************
-	UDR = data;
-	while(BIT_IS_CLEAR(UCSRA,TXC)){} // Wait until the transmission is complete TXC = 1
-	SET_BIT(UCSRA,TXC); // Clear the TXC flag
-	*******************************************************************/
+	while(UART_write(&data,1) == 0){}
 }
 
 /*
  * Description :
  * Functional responsible for receive byte from another UART device.
+ * Blocking wrapper over UART_read, it waits until a byte is received.
  */
 uint8 UART_recieveByte(void)
 {
-	/* RXC flag is set when the UART receive data so wait until this flag is set to one */
-	while(BIT_IS_CLEAR(UCSRA,RXC)){}
-
-	/*
-	 * Read the received data from the Rx buffer (UDR)
-	 * The RXC flag will be cleared after read the data
-	 */
-    return UDR;		
+	uint8 data;
+
+	while(UART_read(&data,1) == 0){}
+
+    return data;
 }
 
 /*
@@ -131,7 +262,7 @@ void UART_sendString(const uint8 *Str)
 	{
 		UART_sendByte(*Str);
 		Str++;
-	}		
+	}
 	*******************************************************************/
 }
 
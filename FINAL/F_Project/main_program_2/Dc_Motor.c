@@ -11,7 +11,60 @@
  *******************************************************************************/
 #include "Dc_Motor.h"
 #include "gpio.h"
+#include <avr/io.h> /* To use the Timer2 Registers */
 
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Compare value of the full speed, the output stays high all the period */
+#define MOTOR_PWM_TOP                 (0xFF)
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+typedef enum
+{
+	MOTOR_PROFILE_IDLE,MOTOR_PROFILE_ACCELERATE,MOTOR_PROFILE_CRUISE,MOTOR_PROFILE_DECELERATE
+}DcMotor_ProfilePhase;
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/*
+ * Profile state, set up by DcMotor_startProfile while it is idle & moved by the tick ISR.
+ * The speeds are PWM compare values in 8.8 fixed point, so the ramp adds a constant step
+ * every tick without any division in the ISR.
+ */
+static volatile DcMotor_ProfilePhase g_phase = MOTOR_PROFILE_IDLE;
+static uint16 g_speed = 0;
+static uint16 g_step = 0;
+static uint16 g_phaseTicks = 0;  /* ticks left in the current phase */
+static uint16 g_rampTicks = 0;
+static uint16 g_cruiseTicks = 0;
+static boolean g_endless = FALSE; /* the cruise lasts until the motor is stopped */
+
+/* Compare value set by DcMotor_SetSpeed, used while no profile runs */
+static uint8 g_duty = MOTOR_PWM_TOP;
+
+/* Called from the tick ISR when a profile is done */
+static void (*volatile g_callBackPtr)(void) = NULL_PTR;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+/*
+ * Write the PWM compare value of the enable pin, 0 disconnects OC2 & keeps the pin low as the
+ * fast PWM still gives a one count pulse at 0. It can be used from the ISRs.
+ */
+static void DcMotor_writeDuty(uint8 duty);
+
+/*
+ * Write both inputs of the H-bridge for the required direction.
+ */
+static void DcMotor_setDirection(DcMotor_State state);
 
 /*******************************************************************************
  *                      Functions Definitions                                  *
@@ -19,39 +72,198 @@
 
 void DcMotor_Init(void)
 {
-	/* configure pin PB0 & PB1 and PB2 as output pins */
+	/* configure the two motor pins & the enable pin as output pins */
 	GPIO_setupPinDirection(MOTOR_PORT_ID, MOTOR_INPUT1_PIN_ID, PIN_OUTPUT);
 	GPIO_setupPinDirection(MOTOR_PORT_ID, MOTOR_INPUT2_PIN_ID, PIN_OUTPUT);
+	GPIO_setupPinDirection(MOTOR_ENABLE_PORT_ID, MOTOR_ENABLE_PIN_ID, PIN_OUTPUT);
+	GPIO_writePin(MOTOR_ENABLE_PORT_ID, MOTOR_ENABLE_PIN_ID, LOGIC_LOW);
 
 	/* Motor is stopped at the beginning */
-	GPIO_writePin(MOTOR_PORT_ID, MOTOR_INPUT1_PIN_ID, LOGIC_LOW);
-	GPIO_writePin(MOTOR_PORT_ID, MOTOR_INPUT2_PIN_ID, LOGIC_LOW);
+	GPIO_writePortMasked(MOTOR_PORT_ID, MOTOR_PINS_MASK, 0);
+	g_phase = MOTOR_PROFILE_IDLE;
+
+	/* Timer2 in fast PWM mode, non-inverting output on OC2, at the full speed */
+	TCNT2 = 0;
+	TCCR2 = (1<<WGM20) | (1<<WGM21) | MOTOR_PWM_CLOCK;
+	DcMotor_SetSpeed(MOTOR_MAX_SPEED);
+}
+
+static void DcMotor_writeDuty(uint8 duty)
+{
+	uint8 sreg = SREG;
+
+	/* The motor is stopped from the ISRs too (tick & position feedback), so the read-modify-write
+	   of TCCR2 is done with the interrupts disabled */
+	SREG &= ~(1<<7);
+	if(duty == 0)
+	{
+		TCCR2 &= ~(1<<COM21);
+	}
+	else
+	{
+		OCR2 = duty;
+		TCCR2 |= (1<<COM21);
+	}
+	SREG = sreg;
+}
+
+void DcMotor_SetSpeed(uint8 speed)
+{
+	if(speed > MOTOR_MAX_SPEED)
+	{
+		speed = MOTOR_MAX_SPEED;
+	}
+	g_duty = (uint8)(((uint16)speed * MOTOR_PWM_TOP) / MOTOR_MAX_SPEED);
+
+	/* A running profile keeps its own speed */
+	if(g_phase == MOTOR_PROFILE_IDLE)
+	{
+		DcMotor_writeDuty(g_duty);
+	}
 }
 
 void DcMotor_Rotate(DcMotor_State state)
 {
+	if(state == STOP)
+	{
+		/* No profile drives the motor any more */
+		g_phase = MOTOR_PROFILE_IDLE;
+		DcMotor_writeDuty(g_duty);
+	}
+	DcMotor_setDirection(state);
+}
+
+static void DcMotor_setDirection(DcMotor_State state)
+{
+	uint8 pins = 0;
 
 	/* check the state of the motor */
 	if(state == CLOCKWISE)
 	{
 		/* Rotate the motor --> clock wise */
-		GPIO_writePin(MOTOR_PORT_ID, MOTOR_INPUT1_PIN_ID, LOGIC_HIGH);
-		GPIO_writePin(MOTOR_PORT_ID, MOTOR_INPUT2_PIN_ID, LOGIC_LOW);
+		pins = (1 << MOTOR_INPUT1_PIN_ID);
 	}
 	else if(state == ANTI_CLOCKWISE)
 	{
 		/* Rotate the motor --> anti-clock wise */
-		GPIO_writePin(MOTOR_PORT_ID, MOTOR_INPUT1_PIN_ID, LOGIC_LOW);
-		GPIO_writePin(MOTOR_PORT_ID, MOTOR_INPUT2_PIN_ID, LOGIC_HIGH);
+		pins = (1 << MOTOR_INPUT2_PIN_ID);
+	}
+	else
+	{
+		/* Stop the motor */
+		pins = 0;
+	}
 
+	/* Both inputs of the H-bridge change in the same write, so a direction change never passes
+	   through a transient state of the bridge */
+	GPIO_writePortMasked(MOTOR_PORT_ID, MOTOR_PINS_MASK, pins);
+}
+
+void DcMotor_startProfile(DcMotor_State direction, uint8 speed, uint16 travel_ms)
+{
+	uint16 cruise;
+	uint16 full_ramp;
+
+	if(speed > MOTOR_MAX_SPEED)
+	{
+		speed = MOTOR_MAX_SPEED;
 	}
 
-	else if(state == STOP)
+	/* The same acceleration at every speed, so the ramp is shorter for a lower speed */
+	cruise = ((uint16)speed * MOTOR_PWM_TOP) / MOTOR_MAX_SPEED;
+	full_ramp = (uint16)(((uint32)MOTOR_RAMP_MS * speed) / MOTOR_MAX_SPEED);
+	if((cruise == 0) || (full_ramp == 0) || (travel_ms == 1))
 	{
-		/* Stop the motor */
-		GPIO_writePin(MOTOR_PORT_ID, MOTOR_INPUT1_PIN_ID, LOGIC_LOW);
-		GPIO_writePin(MOTOR_PORT_ID, MOTOR_INPUT2_PIN_ID, LOGIC_LOW);
+		/* Nothing to run, the profile is done at once so the caller still gets its Call Back */
+		DcMotor_Rotate(STOP);
+		if(g_callBackPtr != NULL_PTR)
+		{
+			(*g_callBackPtr)();
+		}
+		return;
+	}
+
+	g_step = (uint16)(((uint32)cruise << 8) / full_ramp);
+	g_endless = (travel_ms == MOTOR_ENDLESS_TRAVEL) ? TRUE : FALSE;
+	if(g_endless)
+	{
+		g_rampTicks = full_ramp;
+		g_cruiseTicks = 0;
+	}
+	else
+	{
+		g_rampTicks = (full_ramp > (travel_ms / 2)) ? (travel_ms / 2) : full_ramp;
+		g_cruiseTicks = travel_ms - (2 * g_rampTicks);
 	}
 
+	/* Start from stop, the tick ISR takes it from here */
+	g_speed = 0;
+	g_phaseTicks = g_rampTicks;
+	g_phase = MOTOR_PROFILE_ACCELERATE;
+	DcMotor_writeDuty(0);
+	DcMotor_setDirection(direction);
 }
 
+void DcMotor_tick(void)
+{
+	switch(g_phase)
+	{
+	case MOTOR_PROFILE_ACCELERATE:
+		g_speed += g_step;
+		break;
+	case MOTOR_PROFILE_DECELERATE:
+		g_speed = (g_speed > g_step) ? (g_speed - g_step) : 0;
+		break;
+	case MOTOR_PROFILE_CRUISE:
+		if(g_endless)
+		{
+			return;
+		}
+		break;
+	default:
+		return;
+	}
+
+	g_phaseTicks--;
+	while(g_phaseTicks == 0)
+	{
+		if(g_phase == MOTOR_PROFILE_ACCELERATE)
+		{
+			g_phase = MOTOR_PROFILE_CRUISE;
+			g_phaseTicks = g_cruiseTicks;
+			if(g_endless)
+			{
+				break;
+			}
+		}
+		else if(g_phase == MOTOR_PROFILE_CRUISE)
+		{
+			g_phase = MOTOR_PROFILE_DECELERATE;
+			g_phaseTicks = g_rampTicks;
+		}
+		else
+		{
+			/* The profile is done, the motor is stopped */
+			g_speed = 0;
+			DcMotor_Rotate(STOP);
+			if(g_callBackPtr != NULL_PTR)
+			{
+				(*g_callBackPtr)();
+			}
+			return;
+		}
+	}
+
+	DcMotor_writeDuty((uint8)(g_speed >> 8));
+}
+
+boolean DcMotor_isMoving(void)
+{
+	return (g_phase != MOTOR_PROFILE_IDLE) ? TRUE : FALSE;
+}
+
+void DcMotor_setCallBack(void(*a_ptr)(void))
+{
+	/* Save the address of the Call back function in a global variable */
+	g_callBackPtr = a_ptr;
+}
@@ -24,6 +24,28 @@
 #define MOTOR_INPUT1_PIN_ID           PIN6_ID
 #define MOTOR_INPUT2_PIN_ID           PIN7_ID
 
+/* Both inputs of the H-bridge, they must be in the same port */
+#define MOTOR_PINS_MASK               ((1 << MOTOR_INPUT1_PIN_ID) | (1 << MOTOR_INPUT2_PIN_ID))
+
+/* Enable input of the H-bridge, driven by the Timer2 fast PWM output OC2 (PD7 in ATmega16).
+   The Proteus design in FINAL/Final_protues does not drive the enable from the MCU yet, its
+   EN1 must be wired to PD7 */
+#define MOTOR_ENABLE_PORT_ID          PORTD_ID
+#define MOTOR_ENABLE_PIN_ID           PIN7_ID
+
+/* Timer2 clock select bits (CS22:0) of the PWM, F_CPU/8 gives 488 Hz at 1 MHz */
+#define MOTOR_PWM_CLOCK               (1<<CS21)
+
+/* Speeds are given in percent of the full speed */
+#define MOTOR_MAX_SPEED               100
+
+/* Time to accelerate from stop to the full speed & to decelerate back, in system ticks (ms),
+   the profiles at a lower speed ramp with the same acceleration */
+#define MOTOR_RAMP_MS                 1000
+
+/* Travel time of a profile that runs until the motor is stopped by DcMotor_Rotate(STOP) */
+#define MOTOR_ENDLESS_TRAVEL          0
+
 typedef enum
 {
 	STOP,CLOCKWISE,ANTI_CLOCKWISE
@@ -38,6 +60,7 @@ typedef enum
  *  The Function responsible for setup the direction for the two
     motor pins through the GPIO driver.
  *  Stop at the DC-Motor at the beginning through the GPIO driver.
+ *  Setup Timer2 in fast PWM mode on the enable pin at the full speed.
  */
 void DcMotor_Init(void);
 
@@ -45,8 +68,50 @@ void DcMotor_Init(void);
  * Description :
  * The function responsible for rotate the DC Motor CW/ or A-CW or
    stop the motor based on the state input state value..
+ * The motor runs at the speed set by DcMotor_SetSpeed (the full speed after DcMotor_Init),
+   STOP also cancels a running profile.
  */
 
 void DcMotor_Rotate(DcMotor_State state);
 
+/*
+ * Description :
+ * Set the PWM duty cycle of the motor enable at once, from 0 to MOTOR_MAX_SPEED percent.
+ */
+void DcMotor_SetSpeed(uint8 speed);
+
+/*
+ * Description :
+ * Start a trapezoidal speed profile in the given direction that lasts travel_ms:
+ * 1. accelerate from stop to the speed (in percent) in MOTOR_RAMP_MS * speed / MOTOR_MAX_SPEED
+ * 2. run at the speed
+ * 3. decelerate to stop at the end of travel_ms, then the motor is stopped & the Call Back is called
+ * A travel too short for both ramps becomes a triangle that peaks below the speed.
+ * A travel of MOTOR_ENDLESS_TRAVEL accelerates & keeps the speed until DcMotor_Rotate(STOP),
+ * without any Call Back (e.g. the motor is stopped by a position feedback).
+ * The motor must be stopped before the profile starts, it is run by DcMotor_tick.
+ * A speed of 0 or a travel of 1 ms has nothing to run: the motor is stopped & the Call Back is
+ * called at once, from the caller.
+ */
+void DcMotor_startProfile(DcMotor_State direction, uint8 speed, uint16 travel_ms);
+
+/*
+ * Description :
+ * Move the running profile one system tick forward, it must be called every system tick
+ * (from the tick ISR).
+ */
+void DcMotor_tick(void);
+
+/*
+ * Description :
+ * Return TRUE while a profile is running.
+ */
+boolean DcMotor_isMoving(void);
+
+/*
+ * Description :
+ * Set the Call Back function called from the tick ISR when a profile is done.
+ */
+void DcMotor_setCallBack(void(*a_ptr)(void));
+
 #endif /* DC_MOTOR_H_ */
@@ -9,6 +9,9 @@ C_SRCS += \
 ../buzzer.c \
 ../external_eeprom.c \
 ../gpio.c \
+../position.c \
+../protocol.c \
+../scheduler.c \
 ../timer.c \
 ../twi.c \
 ../uart.c 
@@ -19,6 +22,9 @@ OBJS += \
 ./buzzer.o \
 ./external_eeprom.o \
 ./gpio.o \
+./position.o \
+./protocol.o \
+./scheduler.o \
 ./timer.o \
 ./twi.o \
 ./uart.o 
@@ -29,6 +35,9 @@ C_DEPS += \
 ./buzzer.d \
 ./external_eeprom.d \
 ./gpio.d \
+./position.d \
+./protocol.d \
+./scheduler.d \
 ./timer.d \
 ./twi.d \
 ./uart.d 
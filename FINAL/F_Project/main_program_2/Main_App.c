@@ -12,26 +12,23 @@
 #include "buzzer.h"
 #include "external_eeprom.h"
 #include "Dc_Motor.h"
+#include "position.h"
 #include "uart.h"
 #include "timer.h"
 #include "twi.h"
+#include "protocol.h"
+#include "scheduler.h"
 #include <string.h>
+#include <avr/io.h> /* To use the SREG Register */
 
 /*******************************************************************************
  *                                Definitions                                  *
  *******************************************************************************/
 
-/* Extern the global variable in timer, UART and I2C files */
-extern Timer_ConfigType TIMER0_config;
+/* Extern the global variable in UART and I2C files */
 extern UART_ConfigType UART_config;
 extern Twi_ConfigType TWI_config;
 
-/* global variable contain the ticks count of the timer */
-uint32 g_tick=0;
-
-/* declaring an array for the received password */
-uint8 password_received[10];
-
 /* declaring an array for the stored password */
 uint8 password_real[10];
 
@@ -41,130 +38,383 @@ uint8 error_check = 0;
 #define UN_MATCHED       1
 #define MATCHED          0
 
-/* define timer constants */
-#define NUMBER_OF_OVERFLOWS_PER_SECOND          500
-#define NUMBER_OF_OVERFLOWS_PER_MILLI_SECOND    5
+/* number of digits in the password */
+#define PASSWORD_LENGTH                         5
 
 /* EEPROM position to be stored in */
 #define EEPROM_STORAGE_PLACE                    0x0311
 
-/* shared Commands between MC1 & MC2 */
-#define CORRECT_PASSWORD          (0x01)
-#define WRONG_PASSWORD            (0x02)
-#define OPEN_DOOR                 (0x03)
-#define FIRE_BUZZER               (0x04)
-#define CHANGE_PASSWORD           (0x05)
-#define CHECK_PASSWORD            (0x06)
+/* Software timers ids */
+#define BUZZER_TIMER_ID                         0
+#define DOOR_TIMER_ID                           1
+
+/* Buzzer duration after 3 wrong passwords */
+#define BUZZER_DURATION_MS                      10000
+
+/* Set to 1 if the door has its limit switches (and optionally the encoder, see position.h):
+   it then moves until it reaches its end. With 0 it moves for its nominal travel time, as on
+   the Proteus design which has no position feedback */
+#define DOOR_POSITION_FEEDBACK                  0
+
+/* Door phases timings, the travel & hold times are shared with MC1 in protocol.h */
+#define DOOR_OPENING_MS                         DOOR_MOVING_MS
+#define DOOR_HELD_MS                            DOOR_HOLD_MS
+#define DOOR_CLOSING_MS                         DOOR_MOVING_MS
+
+/* The timed travel covers the door distance only if the profile ramps are the ones it adds */
+#if (DOOR_RAMP_MS != MOTOR_RAMP_MS)
+#error "DOOR_RAMP_MS in protocol.h must be equal to MOTOR_RAMP_MS"
+#endif
+
+/* With the position feedback, time the door gets to reach its end: an opening door that does
+   not reach it is closed again, a closing door that does not reach it is stopped in FAULT */
+#define DOOR_TRAVEL_TIMEOUT_MS(travel_ms)       ((travel_ms) + ((travel_ms) / 2))
+
+/* Door motor speeds in percent */
+#define DOOR_OPENING_SPEED                      100
+#define DOOR_CLOSING_SPEED                      100
+
+/* Events dispatched by the main loop */
+#define EVENT_FRAME_RECEIVED                    0
+#define EVENT_DOOR_DONE                         1 /* end position reached or end of the hold time */
+#define EVENT_BUZZER_TIMER                      2
+#define EVENT_DOOR_TIMEOUT                      3 /* end position not reached in time */
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* States of the door, their values are the states reported to MC1 by DOOR_STATUS */
+typedef enum
+{
+	DOOR_CLOSED = DOOR_STATE_CLOSED,
+	DOOR_OPENING = DOOR_STATE_OPENING,
+	DOOR_HELD = DOOR_STATE_HELD,
+	DOOR_CLOSING = DOOR_STATE_CLOSING,
+	DOOR_FAULT = DOOR_STATE_FAULT,
+	DOOR_NUM_STATES
+}DOOR_StateType;
+
+/* Events of the door state machine */
+typedef enum
+{
+	DOOR_REQUEST_OPEN,  /* OPEN_DOOR or a verified VERIFY_AND_OPEN */
+	DOOR_PHASE_DONE,    /* the end position is reached or the hold time is over */
+	DOOR_REQUEST_STOP,  /* EMERGENCY_STOP */
+	DOOR_TRAVEL_TIMEOUT /* the end position is not reached in time */
+}DOOR_EventType;
+
+/* Hooks called when the door enters & leaves a state, NULL_PTR if there is nothing to do */
+typedef struct
+{
+	void (*entry)(void);
+	void (*exit)(void);
+}DOOR_HooksType;
+
+/* current state of the door */
+DOOR_StateType door_state = DOOR_CLOSED;
+
+/* Generation of the current door state, moved on by every transition. The door timer & the
+   position feedback post their events with the generation they have been armed in, so an
+   event already queued when its state is left (or entered again) is dropped */
+volatile uint8 door_generation = 0;
+
+/* MC2 accepts only a CHANGE_PASSWORD request until the first password is stored */
+boolean password_stored = FALSE;
 
-/* Shared condition to make sure that MC2 is ready to receive new data */
-#define MC2_READY                 (0x10)
 /*******************************************************************************
  *                      Functions Definitions                                  *
  *******************************************************************************/
 
 /*
  * Description :
- * Call-back function that is called to be done when the timer interrupt occurs
+ * Delay Function that works to make specific delays based on the user choice
  */
-void _TIMER0_CALLBACK(void)
+void _delay_second(uint8 seconds)
 {
-	/* incrementing the number of ticks whenever the timer interrupt happens */
-	g_tick++;
+	/* wait on the system tick until the required delay time occurs */
+	Timer_delayMs(seconds * 1000UL);
 }
 
-
 /*
  * Description :
  * Delay Function that works to make specific delays based on the user choice
  */
-void _delay_second(uint8 seconds)
+void _delay_milli_second(uint32 m_seconds)
 {
-	/*Setting up the configuration object for the timer */
-	TIMER0_config.clock = F_CPU_8;
-	TIMER0_config.compare_value = 0;
-	TIMER0_config.initial_value = 0;
-	TIMER0_config.mode = NORMAL;
-
-	/* Setting up & initializing the timer before starting up */
-	 Timer0_setCallBack(_TIMER0_CALLBACK);
-	 Timer0_Init(&TIMER0_config);
+	/* wait on the system tick until the required delay time occurs */
+	Timer_delayMs(m_seconds);
+}
 
-	 /* while loop to hold on the processor until the required delay time occures */
-	 while (g_tick <(seconds * NUMBER_OF_OVERFLOWS_PER_SECOND));
-	 g_tick=0;
 
-	 /* Closing the timer after using it */
-	 Timer_DeInit();
+/*
+ * Description :
+ * Call Back function of the system tick, it decodes the door encoder & runs the speed profile of
+ * the motor in the timer ISR
+ */
+void TICK_CALLBACK(void)
+{
+	POSITION_tick();
+	DcMotor_tick();
 }
 
 /*
  * Description :
- * Delay Function that works to make specific delays based on the user choice
+ * Call Back functions of the software timers & the frame parser, they run in the ISRs so they
+ * only post their events to the main loop
  */
-void _delay_milli_second(uint32 m_seconds)
+void FRAME_RECEIVED_CALLBACK(void)
 {
-	/*Setting up the configuration object for the timer */
-	TIMER0_config.clock = F_CPU_8;
-	TIMER0_config.compare_value = 0;
-	TIMER0_config.initial_value = 0;
-	TIMER0_config.mode = NORMAL;
+	SCHEDULER_postEvent(EVENT_FRAME_RECEIVED,0);
+}
 
-	/* Setting up & initializing the timer before starting up */
-	 Timer0_setCallBack(_TIMER0_CALLBACK);
-	 Timer0_Init(&TIMER0_config);
+void DOOR_DONE_CALLBACK(void)
+{
+	SCHEDULER_postEvent(EVENT_DOOR_DONE,door_generation);
+}
 
-	 /* while loop to hold on the processor until the required delay time occurs */
-	 while (g_tick <(m_seconds * NUMBER_OF_OVERFLOWS_PER_MILLI_SECOND));
-	 g_tick=0;
+void BUZZER_TIMER_CALLBACK(void)
+{
+	SCHEDULER_postEvent(EVENT_BUZZER_TIMER,0);
+}
 
-	 /* Closing the timer after using it */
-	 Timer_DeInit();
+void DOOR_TIMEOUT_CALLBACK(void)
+{
+	SCHEDULER_postEvent(EVENT_DOOR_TIMEOUT,door_generation);
+}
+
+/*
+ * Description :
+ * Call Back function of the position feedback, the motor is stopped in the ISR the instant the
+ * door reaches its end, then the state machine moves on from the main loop
+ */
+void DOOR_REACHED_CALLBACK(void)
+{
+	DcMotor_Rotate(STOP);
+	SCHEDULER_postEvent(EVENT_DOOR_DONE,door_generation);
 }
 
 
 /*
  * Description :
- * Function that handles the operation of buzzer
+ * Function that handles the operation of buzzer, it returns immediately and the buzzer is
+ * turned off by a software timer after 10 seconds
  */
 void TURN_ON_BUZZER(void)
 {
 	/* Turn on the buzzer */
 	BUZZER_on();
 
-	/* Wait for 10 seconds */
-	_delay_second(10);
+	/* Turn off the buzzer after 10 seconds */
+	Timer_start(BUZZER_TIMER_ID,BUZZER_DURATION_MS,BUZZER_TIMER_CALLBACK);
+}
 
-	/* Turn off the buzzer */
+/*
+ * Description :
+ * Handler of the buzzer timer event, turns off the buzzer
+ */
+void BUZZER_TIMEOUT(uint8 param)
+{
 	BUZZER_off();
 }
 
 
 /*
  * Description :
- * Function that handles the opening & closing of the door
- * 1. Open the door by turning the motor on in the Anti-clockwise direction for 15 seconds
- * 2. hold the door opened for 3 seconds
- * 3. Close the door by turning the motor on in the clockwise direction for 15 seconds
- * 4. Stop the motor
+ * Start the motor towards an end of the door:
+ * 1. with the position feedback, until it sees the door at this end, with a timeout on the door
+ *    timer. The motor is started before the end is checked, so an end reached in between is
+ *    not missed
+ * 2. without it, for the nominal travel time, the end of the profile is the end of the travel
  */
-void DOOR_OPERATION(void)
+void DOOR_MOVE(DcMotor_State direction, uint8 speed, POSITION_EndType end, uint16 travel_ms)
 {
-	/* Rotate the motor Anti-clokwise for 15 seconds until the door is opened */
-	DcMotor_Rotate(ANTI_CLOCKWISE);
-	_delay_second(15);
+#if DOOR_POSITION_FEEDBACK
+	DcMotor_startProfile(direction,speed,MOTOR_ENDLESS_TRAVEL);
+	Timer_start(DOOR_TIMER_ID,DOOR_TRAVEL_TIMEOUT_MS(travel_ms),DOOR_TIMEOUT_CALLBACK);
+
+	if(POSITION_moveTo(end))
+	{
+		/* the door is already there */
+		DOOR_REACHED_CALLBACK();
+	}
+#else
+	DcMotor_startProfile(direction,speed,travel_ms);
+#endif
+}
 
-	/* wait for 3 seconds keeping the door open */
+/*
+ * Description :
+ * Entry & exit hooks of the door states:
+ * 1. OPENING & CLOSING run the motor until the door reaches its end which is a DOOR_PHASE_DONE
+ *    event, leaving them stops the motor, the position feedback & the timeout (e.g. on an
+ *    emergency stop)
+ * 2. HELD keeps the door open until the door timer is over, leaving it cancels the timer
+ * 3. FAULT keeps the motor stopped until the next open request
+ */
+void DOOR_OPENING_ENTRY(void)
+{
+	DOOR_MOVE(ANTI_CLOCKWISE,DOOR_OPENING_SPEED,POSITION_OPEN,DOOR_OPENING_MS);
+}
+
+void DOOR_CLOSING_ENTRY(void)
+{
+	DOOR_MOVE(CLOCKWISE,DOOR_CLOSING_SPEED,POSITION_CLOSED,DOOR_CLOSING_MS);
+}
+
+void DOOR_MOVING_EXIT(void)
+{
 	DcMotor_Rotate(STOP);
-	_delay_second(3);
+	POSITION_cancel();
+	Timer_cancel(DOOR_TIMER_ID);
+}
 
-	/* Rotate the motor Clockwise for 15 seconds until the door is closed */
-	DcMotor_Rotate(CLOCKWISE);
-	_delay_second(15);
+void DOOR_HELD_ENTRY(void)
+{
+	Timer_start(DOOR_TIMER_ID,DOOR_HELD_MS,DOOR_DONE_CALLBACK);
+}
 
-	/* Stop the motor after using it */
+void DOOR_HELD_EXIT(void)
+{
+	Timer_cancel(DOOR_TIMER_ID);
+}
+
+void DOOR_FAULT_ENTRY(void)
+{
 	DcMotor_Rotate(STOP);
 }
 
+/* Hooks of every door state */
+const DOOR_HooksType door_hooks[DOOR_NUM_STATES] =
+{
+	[DOOR_CLOSED]  = {NULL_PTR,           NULL_PTR},
+	[DOOR_OPENING] = {DOOR_OPENING_ENTRY, DOOR_MOVING_EXIT},
+	[DOOR_HELD]    = {DOOR_HELD_ENTRY,    DOOR_HELD_EXIT},
+	[DOOR_CLOSING] = {DOOR_CLOSING_ENTRY, DOOR_MOVING_EXIT},
+	[DOOR_FAULT]   = {DOOR_FAULT_ENTRY,   NULL_PTR},
+};
+
+/*
+ * Description :
+ * Move the door to the next state, calling the exit hook of the current state then the
+ * entry hook of the next one. The generation moves on in between, as the exit hook has
+ * cancelled what the state armed
+ */
+void DOOR_TRANSITION(DOOR_StateType next_state)
+{
+	if(door_hooks[door_state].exit != NULL_PTR)
+	{
+		(*door_hooks[door_state].exit)();
+	}
+
+	door_state = next_state;
+	door_generation++;
+
+	if(door_hooks[door_state].entry != NULL_PTR)
+	{
+		(*door_hooks[door_state].entry)();
+	}
+}
+
+/*
+ * Description :
+ * The door state machine, it returns immediately so the requests are served during the
+ * whole door cycle:
+ * 1. CLOSED --open--> OPENING --done--> HELD --done--> CLOSING --done--> CLOSED
+ * 2. an open request while HELD keeps the door open for the full hold time again, while
+ *    CLOSING it opens the door again from where it is if the position feedback tells when it
+ *    is open, while OPENING it is ignored
+ * 3. an opening door that does not reach its end in time is closed again, so it is not left
+ *    open
+ * 4. an emergency stop while moving or HELD, or a closing door that does not reach its end in
+ *    time, stops everything in FAULT, the next open request starts the cycle again from there
+ */
+void DOOR_HANDLE_EVENT(DOOR_EventType event)
+{
+	switch(door_state)
+	{
+	case DOOR_CLOSED:
+	case DOOR_FAULT:
+		if(event == DOOR_REQUEST_OPEN)
+		{
+			DOOR_TRANSITION(DOOR_OPENING);
+		}
+		break;
+	case DOOR_OPENING:
+		if(event == DOOR_PHASE_DONE)
+		{
+			DOOR_TRANSITION(DOOR_HELD);
+		}
+		else if(event == DOOR_TRAVEL_TIMEOUT)
+		{
+			DOOR_TRANSITION(DOOR_CLOSING);
+		}
+		else if(event == DOOR_REQUEST_STOP)
+		{
+			DOOR_TRANSITION(DOOR_FAULT);
+		}
+		break;
+	case DOOR_HELD:
+		if(event == DOOR_PHASE_DONE)
+		{
+			DOOR_TRANSITION(DOOR_CLOSING);
+		}
+		else if(event == DOOR_REQUEST_OPEN)
+		{
+			DOOR_TRANSITION(DOOR_HELD);
+		}
+		else if(event == DOOR_REQUEST_STOP)
+		{
+			DOOR_TRANSITION(DOOR_FAULT);
+		}
+		break;
+	case DOOR_CLOSING:
+		if(event == DOOR_PHASE_DONE)
+		{
+			DOOR_TRANSITION(DOOR_CLOSED);
+		}
+#if DOOR_POSITION_FEEDBACK
+		else if(event == DOOR_REQUEST_OPEN)
+		{
+			/* the position feedback tells when the door is open again, the motor restarts
+			   from stop in the other direction */
+			DOOR_TRANSITION(DOOR_OPENING);
+		}
+#endif
+		else if((event == DOOR_REQUEST_STOP) || (event == DOOR_TRAVEL_TIMEOUT))
+		{
+			DOOR_TRANSITION(DOOR_FAULT);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * Description :
+ * Handler of the door done event, the parameter is the generation it has been armed in
+ */
+void DOOR_DONE(uint8 param)
+{
+	if(param == door_generation)
+	{
+		DOOR_HANDLE_EVENT(DOOR_PHASE_DONE);
+	}
+}
+
+/*
+ * Description :
+ * Handler of the door timeout event, the parameter is the generation it has been armed in
+ */
+void DOOR_TIMEOUT(uint8 param)
+{
+	if(param == door_generation)
+	{
+		DOOR_HANDLE_EVENT(DOOR_TRAVEL_TIMEOUT);
+	}
+}
+
 /*
  * Description :
  * Function that stores the password in the EEPROM
@@ -182,7 +432,7 @@ void STORE_PASSWORD(void)
 	uint8 dummy;
 
 	/* for loop to store the Password in the EEPROM */
-	for(i=0 ; i<5; i++)
+	for(i=0 ; i<PASSWORD_LENGTH; i++)
 	{
 		byte = password_real[i];
 		dummy = EEPROM_writeByte((EEPROM_STORAGE_PLACE + i), byte);
@@ -202,16 +452,14 @@ void STORE_PASSWORD(void)
 /*
  * Description :
  * Function that changes the password
- * 1. it receives the password from the user
+ * 1. it takes the new password from the received frame (of PASSWORD_LENGTH bytes)
  * 2 stores the password in a specific place in the EEPROM
  */
-void PASSWORD_CHANGE(void)
+void PASSWORD_CHANGE(const PROTOCOL_FrameType *frame)
 {
-	/*Sending a message for MC1 to let it know that MC2 is ready */
-	UART_sendByte(MC2_READY);
-
-	/*receiving the new password */
-	UART_receiveString(password_real);
+	/*taking the new password from the frame */
+	memcpy(password_real,frame->payload,PASSWORD_LENGTH);
+	password_real[PASSWORD_LENGTH] = '\0';
 
 	/* storing the password in EEPROM */
 	STORE_PASSWORD();
@@ -234,7 +482,7 @@ void GET_STORED_PASSWORD(void)
 		uint8 dummy;
 
 		/* for loop to store the Password in the EEPROM */
-		for(i=0 ; i<5; i++)
+		for(i=0 ; i<PASSWORD_LENGTH; i++)
 		{
 			dummy = EEPROM_readByte((EEPROM_STORAGE_PLACE + i), &byte);
 			password_real[i]=byte;
@@ -244,7 +492,7 @@ void GET_STORED_PASSWORD(void)
 		}
 
 		/* terminating the saved password by NULL */
-		password_real[5] = '\0';
+		password_real[PASSWORD_LENGTH] = '\0';
 
 		return;
 }
@@ -252,28 +500,144 @@ void GET_STORED_PASSWORD(void)
 
 /*
  * Description :
- * Function that compares the received password with the stored one
+ * Function that compares the password in the received frame (of PASSWORD_LENGTH bytes)
+ * with the stored one
  */
-void COMPARE_PASSWORD(void)
+void COMPARE_PASSWORD(const PROTOCOL_FrameType *frame)
 {
-	/*Sending a message for MC1 to let it know that MC2 is ready */
-	UART_sendByte(MC2_READY);
-
-	/*receiving the password */
-	UART_receiveString(password_received);
-
 	/* get the stored password in the password array */
 	GET_STORED_PASSWORD();
 
-	/* comparing between the stored variable and the received one */
-	if((strcmp(password_real,password_received)) == 0)
+	/* comparing between the stored variable and the received one directly in the frame */
+	if(memcmp(password_real,frame->payload,PASSWORD_LENGTH) == 0)
 		error_check = MATCHED;
 	else
 		error_check = UN_MATCHED;
 
-	/* clear the content of the password arrays */
+	/* clear the content of the password array */
 	strcpy(password_real,"\0");
-	strcpy(password_received,"\0");
+}
+
+
+/*
+ * Description :
+ * Function that serves one request frame from MC1
+ * 1. checks for the received password is it correct or not
+ * 2. fires the buzzer if requested
+ * 3. opens the door using the motor if requested, or right after checking the password
+ *    for a VERIFY_AND_OPEN request
+ * 4.changes the password if requested
+ * Every request is answered by an ACK carrying its result as soon as it is accepted, the
+ * frame is released before that so MC1 can always send its next request in one burst
+ */
+void HANDLE_REQUEST(const PROTOCOL_FrameType *frame)
+{
+	/* declaring choice & sequence number variables of the received request */
+	uint8 choice = frame->command;
+	uint8 seq = frame->seq;
+
+	if(choice == DOOR_STATUS)
+	{
+		/* the state of the door is carried by the ACK */
+		PROTOCOL_releaseFrame();
+		PROTOCOL_sendAck(seq,door_state);
+		return;
+	}
+	else if(choice == EMERGENCY_STOP)
+	{
+		/* accepted at any time, even before the first password */
+		PROTOCOL_releaseFrame();
+		PROTOCOL_sendAck(seq,COMMAND_DONE);
+		DOOR_HANDLE_EVENT(DOOR_REQUEST_STOP);
+		return;
+	}
+
+	if(password_stored == FALSE)
+	{
+		/*receiving the password from MC1 in a CHANGE_PASSWORD frame as it's the first time to
+		  recive the password, nothing else is accepted before the first password */
+		if((choice != CHANGE_PASSWORD) || (frame->length != PASSWORD_LENGTH))
+		{
+			PROTOCOL_releaseFrame();
+			PROTOCOL_sendNak(seq,PROTOCOL_NAK_UNKNOWN_COMMAND);
+			return;
+		}
+	}
+
+	if(choice == OPEN_DOOR)
+	{
+		PROTOCOL_releaseFrame();
+		PROTOCOL_sendAck(seq,COMMAND_DONE);
+
+		/* open the door */
+		DOOR_HANDLE_EVENT(DOOR_REQUEST_OPEN);
+	}
+	else if(choice == FIRE_BUZZER)
+	{
+		PROTOCOL_releaseFrame();
+		PROTOCOL_sendAck(seq,COMMAND_DONE);
+
+		/* call the function to fire the buzzer */
+		TURN_ON_BUZZER();
+	}
+	else if((choice == CHECK_PASSWORD) || (choice == VERIFY_AND_OPEN) || (choice == CHANGE_PASSWORD))
+	{
+		if(frame->length != PASSWORD_LENGTH)
+		{
+			PROTOCOL_releaseFrame();
+			PROTOCOL_sendNak(seq,PROTOCOL_NAK_BAD_LENGTH);
+		}
+		else if(choice != CHANGE_PASSWORD)
+		{
+			/* call the function that checks for entered password */
+			COMPARE_PASSWORD(frame);
+			PROTOCOL_releaseFrame();
+
+			/* sending the state of the received password in the ACK */
+			if(error_check == MATCHED)
+			{
+				PROTOCOL_sendAck(seq,CORRECT_PASSWORD);
+
+				/* the password is verified, so open the door in the same request */
+				if(choice == VERIFY_AND_OPEN)
+				{
+					DOOR_HANDLE_EVENT(DOOR_REQUEST_OPEN);
+				}
+			}
+			else
+			{
+				PROTOCOL_sendAck(seq,WRONG_PASSWORD);
+			}
+		}
+		else
+		{
+			/* call a function that changes the password */
+			PASSWORD_CHANGE(frame);
+			PROTOCOL_releaseFrame();
+			PROTOCOL_sendAck(seq,COMMAND_DONE);
+			password_stored = TRUE;
+		}
+	}
+	else
+	{
+		/* unknown request, reject it */
+		PROTOCOL_releaseFrame();
+		PROTOCOL_sendNak(seq,PROTOCOL_NAK_UNKNOWN_COMMAND);
+	}
+}
+
+/*
+ * Description :
+ * Handler of the frame received event, serves all the queued request frames
+ */
+void FRAME_RECEIVED(uint8 param)
+{
+	const PROTOCOL_FrameType *frame;
+
+	while((frame = PROTOCOL_getFrame()) != NULL_PTR)
+	{
+		HANDLE_REQUEST(frame);
+	}
 }
 
 
@@ -284,8 +648,15 @@ void COMPARE_PASSWORD(void)
  *******************************************************************************/
 int main(void)
 {
-	/* declaring choice variable to use it in the program */
-	uint8 choice = 0;
+	/* Starting the system tick that all the delays & timeouts are built on */
+	Timer_initSystemTick();
+
+	/* Every request, door phase & buzzer timeout is an event handled by the main loop */
+	SCHEDULER_init();
+	SCHEDULER_setHandler(EVENT_FRAME_RECEIVED,FRAME_RECEIVED);
+	SCHEDULER_setHandler(EVENT_DOOR_DONE,DOOR_DONE);
+	SCHEDULER_setHandler(EVENT_BUZZER_TIMER,BUZZER_TIMEOUT);
+	SCHEDULER_setHandler(EVENT_DOOR_TIMEOUT,DOOR_TIMEOUT);
 
 	/*Setting up the Configuration object for I2C */
 	TWI_config.Bit_Rate = Fast_mode;
@@ -295,76 +666,33 @@ int main(void)
 	TWI_init(&TWI_config);
 
 	/*Setting up the Configuration object for UART */
-	UART_config.Baud_Rate = 9600;
 	UART_config.Bits_Number = _8_BITS;
 	UART_config.Parity = EVEN_PARITY;
 	UART_config.Stop_Bits_Number = _1_STOP_BIT;
 
-	/* Initializing UART */
+	/* Initializing UART & the frame parser on top of it */
 	UART_init(&UART_config);
+	PROTOCOL_init();
+	PROTOCOL_setFrameCallBack(FRAME_RECEIVED_CALLBACK);
 
-	/* initializing the motor */
+	/* initializing the motor, its profiles are run by the system tick until the position feedback
+	   sees the door at its end, or for the travel time if there is no feedback */
 	DcMotor_Init();
+#if DOOR_POSITION_FEEDBACK
+	POSITION_init();
+	POSITION_setCallBack(DOOR_REACHED_CALLBACK);
+#else
+	DcMotor_setCallBack(DOOR_DONE_CALLBACK);
+#endif
+	Timer0_setCallBack(TICK_CALLBACK);
 
 	/*Initializing the buzzer */
 	BUZZER_init();
 
-	/* MC2 takes the password for the first time and stores it in EEPROM  */
+	/* Enable interrupts */
+	SREG |= (1<<7);
 
-	/*receiving the password from MC1 in password_real array as it's the first time to recive
-	  the password
-	 */
-	UART_receiveString(password_real);
-
-	/*store the password in EEPROM */
-	STORE_PASSWORD();
-
-	/* Now going through the program of MC2
-	 * 1. checks for the received password is it correct or not
-	 * 2. fires the buzzer if requested
-	 * 3. opens the door using the motor if requested
-	 * 4.changes the password if requested
-	 */
-
-
-	while(1)
-	{
-
-		/*Sending a message for MC1 to let it know that MC2 is ready */
-		UART_sendByte(MC2_READY);
-
-		/*receiving the request from MC1 */
-		choice = UART_recieveByte();
-
-		if(choice == OPEN_DOOR)
-		{
-			/* call the function to open the door */
-			DOOR_OPERATION();
-		}
-		else if(choice == FIRE_BUZZER)
-		{
-			/* call the function to fire the buzzer */
-			TURN_ON_BUZZER();
-		}
-		else if(choice == CHECK_PASSWORD)
-		{
-			/* call the function that checks for entered password */
-			COMPARE_PASSWORD();
-
-			/* checking on the state of the received password */
-			if(error_check == MATCHED)
-			{
-				UART_sendByte(CORRECT_PASSWORD);
-			}
-			else if(error_check == UN_MATCHED)
-			{
-				UART_sendByte(WRONG_PASSWORD);
-			}
-		}
-		else if(choice == CHANGE_PASSWORD)
-		{
-			/* call a function that changes the password */
-			PASSWORD_CHANGE();
-		}
-	}
+	/* MC2 takes the password for the first time and stores it in EEPROM, then it serves the
+	 * requests of MC1 while the door & buzzer keep running on their timers */
+	SCHEDULER_run();
 }
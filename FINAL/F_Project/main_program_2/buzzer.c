@@ -31,7 +31,7 @@ void BUZZER_init(void)
  */
 void BUZZER_on(void)
 {
-	GPIO_writePin( BUZZER_PORT , BUZZER_PIN ,LOGIC_HIGH);
+	GPIO_FAST_SET_PIN(BUZZER_PORT,BUZZER_PIN);
 }
 
 /*
@@ -40,7 +40,7 @@ void BUZZER_on(void)
  */
 void BUZZER_off(void)
 {
-	GPIO_writePin( BUZZER_PORT , BUZZER_PIN , LOGIC_LOW);
+	GPIO_FAST_CLEAR_PIN(BUZZER_PORT,BUZZER_PIN);
 
 
 }
@@ -329,3 +329,60 @@ uint8 GPIO_readPort(uint8 port_num)
 
 	return value;
 }
+
+/*
+ * Description :
+ * Write the bits of the value selected by the mask on the required port in one read-modify-write,
+ * the other pins are not changed.
+ * The interrupts are disabled during the write, so it can be used from the ISRs & from the main
+ * loop on the same port.
+ * If the input port number is not correct, The function will not handle the request.
+ */
+void GPIO_writePortMasked(uint8 port_num, uint8 mask, uint8 value)
+{
+	uint8 sreg;
+
+	/*
+	 * Check if the input number is greater than NUM_OF_PORTS value.
+	 * In this case the input is not valid port number
+	 */
+	if(port_num >= NUM_OF_PORTS)
+	{
+		/* Do Nothing */
+	}
+	else
+	{
+		sreg = SREG;
+		SREG &= ~(1<<7);
+
+		/* Write the selected pins of the port as required */
+		switch(port_num)
+		{
+		case PORTA_ID:
+			PORTA = (PORTA & ~mask) | (value & mask);
+			break;
+		case PORTB_ID:
+			PORTB = (PORTB & ~mask) | (value & mask);
+			break;
+		case PORTC_ID:
+			PORTC = (PORTC & ~mask) | (value & mask);
+			break;
+		case PORTD_ID:
+			PORTD = (PORTD & ~mask) | (value & mask);
+			break;
+		}
+
+		SREG = sreg;
+	}
+}
+
+/*
+ * Description :
+ * Read and return the value of the pins selected by the mask in the required port, the other
+ * bits are ZERO.
+ * If the input port number is not correct, The function will return ZERO value.
+ */
+uint8 GPIO_readPortMasked(uint8 port_num, uint8 mask)
+{
+	return (GPIO_readPort(port_num) & mask);
+}
@@ -14,6 +14,7 @@
 #define GPIO_H_
 
 #include "std_types.h"
+#include <avr/io.h> /* For the port registers used by the compile time macros */
 
 /*******************************************************************************
  *                                Definitions                                  *
@@ -35,6 +36,85 @@
 #define PIN6_ID                6
 #define PIN7_ID                7
 
+/*
+ * Compile time GPIO access.
+ * The port & pin arguments must be constants (e.g. PORTA_ID, PIN3_ID or a configuration
+ * macro of a driver), the port id is pasted into the name of its registers and every macro
+ * is a single instruction (sbi/cbi) or three for a read (sbic), even without optimization.
+ * Use the GPIO functions when the port or the pin is only known at run time.
+ */
+#define GPIO_CONCAT(a,b)                 GPIO_CONCAT_(a,b)
+#define GPIO_CONCAT_(a,b)                a##b
+
+/* Registers of a port from its id, e.g. GPIO_PORT_REG(PORTB_ID) is PORTB */
+#define GPIO_PORT_REG(port_id)           GPIO_CONCAT(GPIO_PORT_REG_,port_id)
+#define GPIO_DDR_REG(port_id)            GPIO_CONCAT(GPIO_DDR_REG_,port_id)
+#define GPIO_PIN_REG(port_id)            GPIO_CONCAT(GPIO_PIN_REG_,port_id)
+
+#define GPIO_PORT_REG_0                  PORTA
+#define GPIO_PORT_REG_1                  PORTB
+#define GPIO_PORT_REG_2                  PORTC
+#define GPIO_PORT_REG_3                  PORTD
+#define GPIO_DDR_REG_0                   DDRA
+#define GPIO_DDR_REG_1                   DDRB
+#define GPIO_DDR_REG_2                   DDRC
+#define GPIO_DDR_REG_3                   DDRD
+#define GPIO_PIN_REG_0                   PINA
+#define GPIO_PIN_REG_1                   PINB
+#define GPIO_PIN_REG_2                   PINC
+#define GPIO_PIN_REG_3                   PIND
+
+/* Set/clear one bit of an I/O register (sbi/cbi, 2 cycles) */
+#define GPIO_SBI(reg,pin_id)             __asm__ __volatile__("sbi %0,%1" :: "I"(_SFR_IO_ADDR(reg)), "I"(pin_id))
+#define GPIO_CBI(reg,pin_id)             __asm__ __volatile__("cbi %0,%1" :: "I"(_SFR_IO_ADDR(reg)), "I"(pin_id))
+
+/* Busy wait of at least "ns" nano-seconds (a constant) with NOPs, for the short timings of the
+   devices on the pins: util/delay calls floating point functions when the optimizations are off
+   (1 NOP per micro-second at 1 MHz) */
+#define GPIO_NS_TO_CYCLES(ns)            ((((F_CPU / 1000UL) * (ns)) + 999999UL) / 1000000UL)
+#define GPIO_DELAY_NS(ns)                __asm__ __volatile__(".rept %0" "\n\t" "nop" "\n\t" ".endr" :: "n"(GPIO_NS_TO_CYCLES(ns)))
+
+/* Setup the direction of a pin */
+#define GPIO_FAST_SET_OUTPUT(port_id,pin_id)  GPIO_SBI(GPIO_DDR_REG(port_id),pin_id)
+#define GPIO_FAST_SET_INPUT(port_id,pin_id)   GPIO_CBI(GPIO_DDR_REG(port_id),pin_id)
+
+/* Write Logic High/Low on a pin, the value may be a variable (a test & sbi or cbi) */
+#define GPIO_FAST_SET_PIN(port_id,pin_id)     GPIO_SBI(GPIO_PORT_REG(port_id),pin_id)
+#define GPIO_FAST_CLEAR_PIN(port_id,pin_id)   GPIO_CBI(GPIO_PORT_REG(port_id),pin_id)
+#define GPIO_FAST_WRITE_PIN(port_id,pin_id,value)                         \
+	do {                                                                  \
+		if((value) != LOGIC_LOW) { GPIO_FAST_SET_PIN(port_id,pin_id); }   \
+		else { GPIO_FAST_CLEAR_PIN(port_id,pin_id); }                     \
+	} while(0)
+
+/* Write the bits of "value" selected by "mask" in a register in one read-modify-write with the
+   interrupts disabled, the other pins are not changed so it can be used from the ISRs */
+#define GPIO_WRITE_MASKED(reg,mask,value)                                 \
+	do {                                                                  \
+		uint8 gpio_sreg_ = SREG;                                          \
+		SREG &= ~(1<<7);                                                  \
+		(reg) = ((reg) & (uint8)~(mask)) | ((value) & (mask));            \
+		SREG = gpio_sreg_;                                                \
+	} while(0)
+
+/* Masked write of the output/pull up values & of the directions of a port */
+#define GPIO_FAST_WRITE_MASKED(port_id,mask,value)   GPIO_WRITE_MASKED(GPIO_PORT_REG(port_id),mask,value)
+#define GPIO_FAST_SETUP_MASKED(port_id,mask,value)   GPIO_WRITE_MASKED(GPIO_DDR_REG(port_id),mask,value)
+
+/* Read the pins selected by the mask, the other bits are zero */
+#define GPIO_FAST_READ_MASKED(port_id,mask)          (GPIO_PIN_REG(port_id) & (mask))
+
+/* Read a pin as Logic High/Low (ldi, sbic, ldi) */
+#define GPIO_FAST_READ_PIN(port_id,pin_id)                                \
+	({                                                                    \
+		uint8 gpio_value_;                                                \
+		__asm__ __volatile__("ldi %0,%3" "\n\t" "sbic %1,%2" "\n\t" "ldi %0,%4" \
+			: "=d"(gpio_value_)                                           \
+			: "I"(_SFR_IO_ADDR(GPIO_PIN_REG(port_id))), "I"(pin_id),      \
+			  "M"(LOGIC_LOW), "M"(LOGIC_HIGH));                           \
+		gpio_value_;                                                      \
+	})
+
 /*******************************************************************************
  *                               Types Declaration                             *
  *******************************************************************************/
@@ -99,4 +179,20 @@ void GPIO_writePort(uint8 port_num, uint8 value);
  */
 uint8 GPIO_readPort(uint8 port_num);
 
+/*
+ * Description :
+ * Write the bits of the value selected by the mask on the required port in one read-modify-write,
+ * the other pins are not changed, so pins that change together never show a transient state.
+ * The interrupts are disabled during the write, it can be used from the ISRs.
+ * If the input port number is not correct, The function will not handle the request.
+ */
+void GPIO_writePortMasked(uint8 port_num, uint8 mask, uint8 value);
+
+/*
+ * Description :
+ * Read and return the value of the pins selected by the mask in the required port.
+ * If the input port number is not correct, The function will return ZERO value.
+ */
+uint8 GPIO_readPortMasked(uint8 port_num, uint8 mask);
+
 #endif /* GPIO_H_ */
@@ -0,0 +1,224 @@
+ /******************************************************************************
+ *
+ * Module: Position
+ *
+ * File Name: position.c
+ *
+ * Description: Source file for the door position feedback (limit switches & encoder)
+ *
+ * Author: Belal Badr
+ *
+ *******************************************************************************/
+#include "position.h"
+#include "gpio.h"
+#include <avr/io.h> /* To use the external interrupts Registers */
+#include <avr/interrupt.h> /* For the INT0 & INT1 ISRs */
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define POSITION_ENCODER_MASK            ((1 << POSITION_ENCODER_A_PIN_ID) | (1 << POSITION_ENCODER_B_PIN_ID))
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* End the door is moving to, POSITION_NONE while nobody waits for it */
+static volatile POSITION_EndType g_target = POSITION_NONE;
+
+/* Encoder count, written by the ISRs only */
+static volatile sint16 g_count = 0;
+
+#if POSITION_ENCODER
+/* Channels (A B) read on the previous tick */
+static uint8 g_lastChannels = 0;
+
+/* Count step of every transition, indexed by the previous & the current channels (A B A B),
+   0 for no move or for an invalid jump over one state */
+static const sint8 g_quadratureTable[16] =
+{
+	0, 1,-1, 0,
+	-1, 0, 0, 1,
+	1, 0, 0,-1,
+	0,-1, 1, 0
+};
+#endif
+
+/* Called from the ISRs when the door reaches the target */
+static void (*volatile g_callBackPtr)(void) = NULL_PTR;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+/*
+ * Called from the ISRs when the door is at the given end, the Call Back is called once if it
+ * is the target.
+ */
+static void POSITION_reached(POSITION_EndType end);
+
+#if POSITION_ENCODER
+/*
+ * Read both encoder channels as (A B).
+ */
+static uint8 POSITION_readChannels(void);
+#endif
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+ISR(INT0_vect)
+{
+	/* The open limit switch has closed */
+	g_count = POSITION_OPEN_COUNT;
+	POSITION_reached(POSITION_OPEN);
+}
+
+ISR(INT1_vect)
+{
+	/* The closed limit switch has closed */
+	g_count = 0;
+	POSITION_reached(POSITION_CLOSED);
+}
+
+void POSITION_init(void)
+{
+	GPIO_setupPinDirection(POSITION_OPEN_SWITCH_PORT_ID, POSITION_OPEN_SWITCH_PIN_ID, PIN_INPUT);
+	GPIO_writePin(POSITION_OPEN_SWITCH_PORT_ID, POSITION_OPEN_SWITCH_PIN_ID, LOGIC_HIGH);
+	GPIO_setupPinDirection(POSITION_CLOSED_SWITCH_PORT_ID, POSITION_CLOSED_SWITCH_PIN_ID, PIN_INPUT);
+	GPIO_writePin(POSITION_CLOSED_SWITCH_PORT_ID, POSITION_CLOSED_SWITCH_PIN_ID, LOGIC_HIGH);
+
+	g_target = POSITION_NONE;
+	g_count = 0;
+
+#if POSITION_ENCODER
+	GPIO_FAST_SETUP_MASKED(POSITION_ENCODER_PORT_ID, POSITION_ENCODER_MASK, 0);
+	GPIO_FAST_WRITE_MASKED(POSITION_ENCODER_PORT_ID, POSITION_ENCODER_MASK, POSITION_ENCODER_MASK);
+	g_lastChannels = POSITION_readChannels();
+#endif
+
+	/* INT0 & INT1 on the falling edge, the bounces of a switch are ignored as the target is
+	   cleared by its first edge */
+	MCUCR = (MCUCR & ~((1<<ISC00) | (1<<ISC01) | (1<<ISC10) | (1<<ISC11))) | (1<<ISC01) | (1<<ISC11);
+	GIFR = (1<<INTF0) | (1<<INTF1);
+	GICR |= (1<<INT0) | (1<<INT1);
+}
+
+static void POSITION_reached(POSITION_EndType end)
+{
+	if(g_target == end)
+	{
+		g_target = POSITION_NONE;
+		if(g_callBackPtr != NULL_PTR)
+		{
+			(*g_callBackPtr)();
+		}
+	}
+}
+
+boolean POSITION_moveTo(POSITION_EndType end)
+{
+	boolean arrived;
+	uint8 sreg = SREG;
+
+	/* The end is checked with the target set & the interrupts disabled, so it is either seen
+	   here or by the ISRs but never missed in between */
+	SREG &= ~(1<<7);
+	g_target = end;
+	arrived = POSITION_isAt(end);
+	if(arrived)
+	{
+		g_target = POSITION_NONE;
+	}
+	SREG = sreg;
+
+	return arrived;
+}
+
+void POSITION_cancel(void)
+{
+	g_target = POSITION_NONE;
+}
+
+boolean POSITION_isAt(POSITION_EndType end)
+{
+	if(end == POSITION_OPEN)
+	{
+		if(GPIO_FAST_READ_PIN(POSITION_OPEN_SWITCH_PORT_ID, POSITION_OPEN_SWITCH_PIN_ID) == LOGIC_LOW)
+		{
+			return TRUE;
+		}
+#if POSITION_ENCODER
+		return (g_count >= POSITION_OPEN_COUNT) ? TRUE : FALSE;
+#endif
+	}
+	else if(end == POSITION_CLOSED)
+	{
+		if(GPIO_FAST_READ_PIN(POSITION_CLOSED_SWITCH_PORT_ID, POSITION_CLOSED_SWITCH_PIN_ID) == LOGIC_LOW)
+		{
+			return TRUE;
+		}
+#if POSITION_ENCODER
+		return (g_count <= 0) ? TRUE : FALSE;
+#endif
+	}
+	return FALSE;
+}
+
+#if POSITION_ENCODER
+static uint8 POSITION_readChannels(void)
+{
+	uint8 pins = GPIO_FAST_READ_MASKED(POSITION_ENCODER_PORT_ID, POSITION_ENCODER_MASK);
+	uint8 channels = 0;
+
+	if(pins & (1 << POSITION_ENCODER_A_PIN_ID))
+	{
+		channels |= 0x02;
+	}
+	if(pins & (1 << POSITION_ENCODER_B_PIN_ID))
+	{
+		channels |= 0x01;
+	}
+	return channels;
+}
+#endif
+
+void POSITION_tick(void)
+{
+#if POSITION_ENCODER
+	uint8 channels = POSITION_readChannels();
+
+	g_count += g_quadratureTable[(g_lastChannels << 2) | channels];
+	g_lastChannels = channels;
+
+	if(g_count >= POSITION_OPEN_COUNT)
+	{
+		POSITION_reached(POSITION_OPEN);
+	}
+	else if(g_count <= 0)
+	{
+		POSITION_reached(POSITION_CLOSED);
+	}
+#endif
+}
+
+sint16 POSITION_getCount(void)
+{
+	sint16 count;
+	uint8 sreg = SREG;
+
+	/* The count is written by the ISRs, read its two bytes atomically */
+	SREG &= ~(1<<7);
+	count = g_count;
+	SREG = sreg;
+
+	return count;
+}
+
+void POSITION_setCallBack(void(*a_ptr)(void))
+{
+	/* Save the address of the Call back function in a global variable */
+	g_callBackPtr = a_ptr;
+}
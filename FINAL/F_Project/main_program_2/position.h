@@ -0,0 +1,102 @@
+ /******************************************************************************
+ *
+ * Module: Position
+ *
+ * File Name: position.h
+ *
+ * Description: Header file for the door position feedback (limit switches & encoder)
+ *
+ * Author: Belal Badr
+ *
+ *******************************************************************************/
+
+#ifndef POSITION_H_
+#define POSITION_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Limit switches, they connect their pin to the ground when the door is at their end (the
+   internal pull-ups are used), they must be on INT0 (PD2) & INT1 (PD3) in ATmega16 */
+#define POSITION_OPEN_SWITCH_PORT_ID     PORTD_ID
+#define POSITION_OPEN_SWITCH_PIN_ID      PIN2_ID
+#define POSITION_CLOSED_SWITCH_PORT_ID   PORTD_ID
+#define POSITION_CLOSED_SWITCH_PIN_ID    PIN3_ID
+
+/* Set to 1 if a quadrature encoder is fitted on the door, its channels are polled every system
+   tick so it must not give more than one edge per milli-second */
+#define POSITION_ENCODER                 0
+
+/* Encoder channels, they must be in the same port (swap them if it counts down while opening) */
+#define POSITION_ENCODER_PORT_ID         PORTA_ID
+#define POSITION_ENCODER_A_PIN_ID        PIN0_ID
+#define POSITION_ENCODER_B_PIN_ID        PIN1_ID
+
+/* Encoder counts from the closed to the open position */
+#define POSITION_OPEN_COUNT              1200
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+typedef enum
+{
+	POSITION_CLOSED,POSITION_OPEN,POSITION_NONE
+}POSITION_EndType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Setup the limit switches pins as inputs with their pull-ups & their external interrupts on
+ * the falling edge, and the encoder pins if it is fitted. The encoder count starts at the
+ * closed position.
+ */
+void POSITION_init(void);
+
+/*
+ * Description :
+ * Wait for the door to reach the given end, the Call Back is called from the ISR as soon as
+ * the limit switch closes or the encoder count reaches the end.
+ * Return TRUE without waiting if the door is already at this end.
+ */
+boolean POSITION_moveTo(POSITION_EndType end);
+
+/*
+ * Description :
+ * Stop waiting for the end given to POSITION_moveTo.
+ */
+void POSITION_cancel(void);
+
+/*
+ * Description :
+ * Return TRUE if the door is at the given end.
+ */
+boolean POSITION_isAt(POSITION_EndType end);
+
+/*
+ * Description :
+ * Decode the encoder channels, it must be called every system tick (from the tick ISR).
+ * It does nothing if no encoder is fitted.
+ */
+void POSITION_tick(void);
+
+/*
+ * Description :
+ * Return the encoder count, from 0 (closed) to POSITION_OPEN_COUNT (open). The limit switches
+ * set it back to their end every time they close.
+ */
+sint16 POSITION_getCount(void);
+
+/*
+ * Description :
+ * Set the Call Back function called from the ISRs when the door reaches the end given to
+ * POSITION_moveTo.
+ */
+void POSITION_setCallBack(void(*a_ptr)(void));
+
+#endif /* POSITION_H_ */
@@ -0,0 +1,337 @@
+ /******************************************************************************
+ *
+ * Module: Protocol
+ *
+ * File Name: protocol.c
+ *
+ * Description: Source file for the framed binary protocol between MC1 & MC2
+ *
+ * Author: Belal Badr
+ *
+ *******************************************************************************/
+#include "protocol.h"
+#include "uart.h"
+#include <util/crc16.h> /* For the CRC-16 CCITT update function */
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+typedef enum
+{
+	WAIT_START,WAIT_COMMAND,WAIT_SEQ,WAIT_LENGTH,WAIT_PAYLOAD,WAIT_CRC_LOW,WAIT_CRC_HIGH
+}PROTOCOL_ParserState;
+
+typedef struct
+{
+	uint8 seq;
+	uint8 result;
+	PROTOCOL_StatusType status;
+}PROTOCOL_CommandType;
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/*
+ * Received frames queue.
+ * The parser (RX ISR) writes directly into g_frames[g_frameHead] and the application reads
+ * g_frames[g_frameTail] in place, so a frame is never copied after it is received.
+ */
+static PROTOCOL_FrameType g_frames[PROTOCOL_RX_FRAMES];
+static volatile uint8 g_frameHead = 0; /* written by the parser only */
+static volatile uint8 g_frameTail = 0; /* written by the application only */
+
+/* Frame that receives the ACK/NAK frames while the queue is full, as they are never queued */
+static PROTOCOL_FrameType g_spareFrame;
+
+/* Parser context, used from the RX ISR only */
+static PROTOCOL_FrameType *g_rxFrame = &g_spareFrame;
+static PROTOCOL_ParserState g_parserState = WAIT_START;
+static uint8 g_payloadIndex = 0;
+static uint16 g_crc = PROTOCOL_CRC_INIT;
+static uint8 g_crcLow = 0;
+
+static volatile uint8 g_errorCount = 0;
+
+/* Called from the RX ISR every time a command frame is queued */
+static void (*volatile g_frameCallBackPtr)(void) = NULL_PTR;
+
+/*
+ * Sent commands window, indexed by (seq & PROTOCOL_WINDOW_MASK).
+ * A slot is set to PROTOCOL_PENDING by the application only when it is not pending and
+ * changed from PROTOCOL_PENDING by the parser (ACK/NAK) or by PROTOCOL_cancel, both only
+ * write a one byte status so no critical section is needed.
+ * A free slot for the next sequence number is one credit.
+ */
+static volatile PROTOCOL_CommandType g_commands[PROTOCOL_WINDOW_SIZE];
+static uint8 g_nextSeq = 0;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+/*
+ * Incremental frame parser, it is fed one byte at a time from the UART RX Complete ISR.
+ */
+static void PROTOCOL_parseByte(uint8 data);
+
+/*
+ * Store the result of a received ACK/NAK frame in the sent commands window.
+ */
+static void PROTOCOL_acknowledge(const PROTOCOL_FrameType *frame);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+void PROTOCOL_init(void)
+{
+	uint8 i;
+
+	g_frameHead = 0;
+	g_frameTail = 0;
+	g_parserState = WAIT_START;
+	g_errorCount = 0;
+
+	for(i=0; i<PROTOCOL_WINDOW_SIZE; i++)
+	{
+		g_commands[i].status = PROTOCOL_ACKED;
+	}
+	g_nextSeq = 0;
+
+	UART_setRxCallBack(PROTOCOL_parseByte);
+}
+
+static void PROTOCOL_parseByte(uint8 data)
+{
+	PROTOCOL_FrameType *frame = g_rxFrame;
+
+	switch(g_parserState)
+	{
+	case WAIT_START:
+		if(data == PROTOCOL_START_BYTE)
+		{
+			if((uint8)(g_frameHead - g_frameTail) >= PROTOCOL_RX_FRAMES)
+			{
+				/* No free frame in the queue, only an ACK/NAK frame can still be accepted */
+				g_rxFrame = &g_spareFrame;
+			}
+			else
+			{
+				g_rxFrame = &g_frames[g_frameHead & PROTOCOL_RX_FRAMES_MASK];
+			}
+			g_crc = PROTOCOL_CRC_INIT;
+			g_parserState = WAIT_COMMAND;
+		}
+		/* Any other byte is noise between frames, skip it until the next start byte */
+		break;
+	case WAIT_COMMAND:
+		frame->command = data;
+		g_crc = _crc_ccitt_update(g_crc,data);
+		g_parserState = WAIT_SEQ;
+		break;
+	case WAIT_SEQ:
+		frame->seq = data;
+		g_crc = _crc_ccitt_update(g_crc,data);
+		g_parserState = WAIT_LENGTH;
+		break;
+	case WAIT_LENGTH:
+		if(data > PROTOCOL_MAX_PAYLOAD)
+		{
+			/* Bad length, resynchronize on the next start byte */
+			g_errorCount++;
+			g_parserState = WAIT_START;
+		}
+		else
+		{
+			frame->length = data;
+			g_payloadIndex = 0;
+			g_crc = _crc_ccitt_update(g_crc,data);
+			g_parserState = (data == 0) ? WAIT_CRC_LOW : WAIT_PAYLOAD;
+		}
+		break;
+	case WAIT_PAYLOAD:
+		frame->payload[g_payloadIndex] = data;
+		g_payloadIndex++;
+		g_crc = _crc_ccitt_update(g_crc,data);
+		if(g_payloadIndex == frame->length)
+		{
+			g_parserState = WAIT_CRC_LOW;
+		}
+		break;
+	case WAIT_CRC_LOW:
+		g_crcLow = data;
+		g_parserState = WAIT_CRC_HIGH;
+		break;
+	case WAIT_CRC_HIGH:
+		if(g_crc != (((uint16)data << 8) | g_crcLow))
+		{
+			g_errorCount++;
+		}
+		else if((frame->command == PROTOCOL_ACK) || (frame->command == PROTOCOL_NAK))
+		{
+			/* Acknowledge of a sent command, consume it here to return its credit */
+			PROTOCOL_acknowledge(frame);
+		}
+		else if(frame == &g_spareFrame)
+		{
+			/* The application is too slow, drop this command frame */
+			g_errorCount++;
+		}
+		else
+		{
+			/* Command frame is complete, hand it to the application */
+			g_frameHead++;
+			if(g_frameCallBackPtr != NULL_PTR)
+			{
+				(*g_frameCallBackPtr)();
+			}
+		}
+		g_parserState = WAIT_START;
+		break;
+	}
+}
+
+static void PROTOCOL_acknowledge(const PROTOCOL_FrameType *frame)
+{
+	volatile PROTOCOL_CommandType *command = &g_commands[frame->seq & PROTOCOL_WINDOW_MASK];
+
+	/* Drop the ACK/NAK of a command that is not waiting any more (e.g. a duplicate) */
+	if((command->status == PROTOCOL_PENDING) && (command->seq == frame->seq))
+	{
+		command->result = (frame->length != 0) ? frame->payload[0] : COMMAND_DONE;
+		command->status = (frame->command == PROTOCOL_ACK) ? PROTOCOL_ACKED : PROTOCOL_NAKED;
+	}
+}
+
+void PROTOCOL_sendFrame(uint8 command, uint8 seq, const uint8 *payload, uint8 length)
+{
+	uint8 i;
+	uint16 crc = PROTOCOL_CRC_INIT;
+
+	if(length > PROTOCOL_MAX_PAYLOAD)
+	{
+		length = PROTOCOL_MAX_PAYLOAD;
+	}
+
+	UART_sendByte(PROTOCOL_START_BYTE);
+
+	UART_sendByte(command);
+	crc = _crc_ccitt_update(crc,command);
+
+	UART_sendByte(seq);
+	crc = _crc_ccitt_update(crc,seq);
+
+	UART_sendByte(length);
+	crc = _crc_ccitt_update(crc,length);
+
+	for(i=0; i<length; i++)
+	{
+		UART_sendByte(payload[i]);
+		crc = _crc_ccitt_update(crc,payload[i]);
+	}
+
+	UART_sendByte((uint8)crc);
+	UART_sendByte((uint8)(crc >> 8));
+}
+
+uint8 PROTOCOL_sendCommand(uint8 command, const uint8 *payload, uint8 length)
+{
+	uint8 seq = g_nextSeq;
+	volatile PROTOCOL_CommandType *slot = &g_commands[seq & PROTOCOL_WINDOW_MASK];
+
+	/* Wait for a credit, the slot is busy until the command sent PROTOCOL_WINDOW_SIZE commands ago is acknowledged */
+	while(slot->status == PROTOCOL_PENDING){}
+
+	slot->seq = seq;
+	slot->status = PROTOCOL_PENDING;
+	g_nextSeq++;
+
+	PROTOCOL_sendFrame(command,seq,payload,length);
+
+	return seq;
+}
+
+PROTOCOL_StatusType PROTOCOL_getResult(uint8 seq, uint8 *result)
+{
+	volatile PROTOCOL_CommandType *slot = &g_commands[seq & PROTOCOL_WINDOW_MASK];
+	PROTOCOL_StatusType status = slot->status;
+
+	if(slot->seq != seq)
+	{
+		/* The slot has been reused, so this command has been acknowledged a long time ago
+		 * and its result is not available any more */
+		return PROTOCOL_EXPIRED;
+	}
+	if(status != PROTOCOL_PENDING)
+	{
+		*result = slot->result;
+	}
+	return status;
+}
+
+PROTOCOL_StatusType PROTOCOL_waitResult(uint8 seq, uint8 *result)
+{
+	PROTOCOL_StatusType status;
+
+	while((status = PROTOCOL_getResult(seq,result)) == PROTOCOL_PENDING){}
+
+	return status;
+}
+
+void PROTOCOL_cancel(uint8 seq)
+{
+	volatile PROTOCOL_CommandType *slot = &g_commands[seq & PROTOCOL_WINDOW_MASK];
+
+	if((slot->seq == seq) && (slot->status == PROTOCOL_PENDING))
+	{
+		slot->status = PROTOCOL_TIMEOUT;
+	}
+}
+
+void PROTOCOL_sendAck(uint8 seq, uint8 result)
+{
+	PROTOCOL_sendFrame(PROTOCOL_ACK,seq,&result,1);
+}
+
+void PROTOCOL_sendNak(uint8 seq, uint8 reason)
+{
+	PROTOCOL_sendFrame(PROTOCOL_NAK,seq,&reason,1);
+}
+
+const PROTOCOL_FrameType * PROTOCOL_getFrame(void)
+{
+	if(g_frameHead == g_frameTail)
+	{
+		return NULL_PTR;
+	}
+	return &g_frames[g_frameTail & PROTOCOL_RX_FRAMES_MASK];
+}
+
+const PROTOCOL_FrameType * PROTOCOL_waitFrame(void)
+{
+	const PROTOCOL_FrameType *frame;
+
+	while((frame = PROTOCOL_getFrame()) == NULL_PTR){}
+
+	return frame;
+}
+
+void PROTOCOL_releaseFrame(void)
+{
+	if(g_frameHead != g_frameTail)
+	{
+		g_frameTail++;
+	}
+}
+
+void PROTOCOL_setFrameCallBack(void(*a_ptr)(void))
+{
+	/* Save the address of the Call back function in a global variable */
+	g_frameCallBackPtr = a_ptr;
+}
+
+uint8 PROTOCOL_getErrorCount(void)
+{
+	return g_errorCount;
+}
@@ -0,0 +1,199 @@
+ /******************************************************************************
+ *
+ * Module: Protocol
+ *
+ * File Name: protocol.h
+ *
+ * Description: Header file for the framed binary protocol between MC1 & MC2
+ *
+ * Author: Belal Badr
+ *
+ *******************************************************************************/
+
+#ifndef PROTOCOL_H_
+#define PROTOCOL_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Frame format:
+ * +-------+---------+-----+--------+-------------------+---------+---------+
+ * | START | COMMAND | SEQ | LENGTH | PAYLOAD (LENGTH)  | CRC LOW | CRC HIGH|
+ * +-------+---------+-----+--------+-------------------+---------+---------+
+ * The CRC-16 (CCITT, initial value 0xFFFF) covers COMMAND, SEQ, LENGTH and PAYLOAD.
+ *
+ * Every command carries a sequence number and is answered by an ACK or a NAK frame with
+ * the same sequence number and a one byte result as payload. The sender may have up to
+ * PROTOCOL_WINDOW_SIZE commands waiting for their ACK/NAK (its credits), which is the number
+ * of frames the receiver can queue, so a command and its data always go out in one burst
+ * without waiting for the receiver to be ready.
+ */
+#define PROTOCOL_START_BYTE       (0x7E)
+#define PROTOCOL_MAX_PAYLOAD      16
+#define PROTOCOL_CRC_INIT         (0xFFFF)
+
+/* Number of received frames that can wait for the application, must be a power of 2 */
+#define PROTOCOL_RX_FRAMES        2
+#define PROTOCOL_RX_FRAMES_MASK   (PROTOCOL_RX_FRAMES - 1)
+
+#if ((PROTOCOL_RX_FRAMES & PROTOCOL_RX_FRAMES_MASK) != 0)
+#error "PROTOCOL_RX_FRAMES must be a power of 2"
+#endif
+
+/* Number of commands that can wait for their ACK/NAK, equal to the frames queue of the peer */
+#define PROTOCOL_WINDOW_SIZE      PROTOCOL_RX_FRAMES
+#define PROTOCOL_WINDOW_MASK      (PROTOCOL_WINDOW_SIZE - 1)
+
+/* Acknowledge frames, they are consumed by the protocol layer and never queued */
+#define PROTOCOL_ACK              (0x20)
+#define PROTOCOL_NAK              (0x21)
+
+/* NAK results */
+#define PROTOCOL_NAK_UNKNOWN_COMMAND  (0x01)
+#define PROTOCOL_NAK_BAD_LENGTH       (0x02)
+
+/* shared Commands between MC1 & MC2 */
+#define CORRECT_PASSWORD          (0x01)
+#define WRONG_PASSWORD            (0x02)
+#define OPEN_DOOR                 (0x03)
+#define FIRE_BUZZER               (0x04)
+#define CHANGE_PASSWORD           (0x05)
+#define CHECK_PASSWORD            (0x06)
+#define VERIFY_AND_OPEN           (0x07) /* check the password and open the door if it is correct */
+#define DOOR_STATUS               (0x08) /* the ACK carries the state of the door */
+#define EMERGENCY_STOP            (0x09) /* stop the motor at once, the door goes to its fault state */
+
+/* Door states carried by the ACK of DOOR_STATUS */
+#define DOOR_STATE_CLOSED         (0x00)
+#define DOOR_STATE_OPENING        (0x01)
+#define DOOR_STATE_HELD           (0x02)
+#define DOOR_STATE_CLOSING        (0x03)
+#define DOOR_STATE_FAULT          (0x04)
+
+/* Door cycle run by MC2 after OPEN_DOOR/VERIFY_AND_OPEN, MC1 shows its progress: the door
+   is opened in DOOR_MOVING_MS, kept open for DOOR_HOLD_MS & closed in DOOR_MOVING_MS.
+   The door mechanism needs DOOR_TRAVEL_MS at the full speed, the motor profile adds half of
+   each of its two speed ramps (MOTOR_RAMP_MS in MC2) to cover the same distance */
+#define DOOR_TRAVEL_MS            15000UL
+#define DOOR_RAMP_MS              1000UL
+#define DOOR_MOVING_MS            (DOOR_TRAVEL_MS + DOOR_RAMP_MS)
+#define DOOR_HOLD_MS              3000UL
+
+/* ACK result of the commands that have no specific result */
+#define COMMAND_DONE              (0x00)
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+typedef enum
+{
+	PROTOCOL_PENDING,PROTOCOL_ACKED,PROTOCOL_NAKED,PROTOCOL_TIMEOUT,PROTOCOL_EXPIRED
+}PROTOCOL_StatusType;
+
+typedef struct
+{
+	uint8 command;
+	uint8 seq;
+	uint8 length;
+	uint8 payload[PROTOCOL_MAX_PAYLOAD];
+}PROTOCOL_FrameType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the protocol layer:
+ * 1. Reset the frame parser and the received frames queue.
+ * 2. Hook the frame parser to the UART RX Complete ISR.
+ * The UART must be initialized before calling this function.
+ */
+void PROTOCOL_init(void);
+
+/*
+ * Description :
+ * Build a frame around the given command, sequence number & payload and queue it on the UART.
+ * A payload longer than PROTOCOL_MAX_PAYLOAD is truncated.
+ */
+void PROTOCOL_sendFrame(uint8 command, uint8 seq, const uint8 *payload, uint8 length);
+
+/*
+ * Description :
+ * Send a command with the next sequence number and return that sequence number.
+ * It waits only if all the credits are used, until the oldest command is acknowledged.
+ */
+uint8 PROTOCOL_sendCommand(uint8 command, const uint8 *payload, uint8 length);
+
+/*
+ * Description :
+ * Return the status of the command sent with the given sequence number.
+ * When it is acknowledged the result carried by the ACK/NAK is stored in "result".
+ * If PROTOCOL_WINDOW_SIZE newer commands have been sent since then, its result is not known
+ * any more: PROTOCOL_EXPIRED is returned & "result" is not written.
+ */
+PROTOCOL_StatusType PROTOCOL_getResult(uint8 seq, uint8 *result);
+
+/*
+ * Description :
+ * Wait until the command sent with the given sequence number is acknowledged and return
+ * its status (same rules as PROTOCOL_getResult).
+ */
+PROTOCOL_StatusType PROTOCOL_waitResult(uint8 seq, uint8 *result);
+
+/*
+ * Description :
+ * Give up waiting for the ACK/NAK of the command sent with the given sequence number.
+ * Its status becomes PROTOCOL_TIMEOUT, its credit is returned and a late ACK/NAK is dropped.
+ */
+void PROTOCOL_cancel(uint8 seq);
+
+/*
+ * Description :
+ * Acknowledge the received command having the given sequence number with a result.
+ */
+void PROTOCOL_sendAck(uint8 seq, uint8 result);
+
+/*
+ * Description :
+ * Reject the received command having the given sequence number with a reason.
+ */
+void PROTOCOL_sendNak(uint8 seq, uint8 reason);
+
+/*
+ * Description :
+ * Return the oldest complete command frame without copying it, or NULL_PTR if no frame has been received.
+ * The frame stays valid until PROTOCOL_releaseFrame is called.
+ */
+const PROTOCOL_FrameType * PROTOCOL_getFrame(void);
+
+/*
+ * Description :
+ * Wait until a complete frame is received and return it (same rules as PROTOCOL_getFrame).
+ */
+const PROTOCOL_FrameType * PROTOCOL_waitFrame(void);
+
+/*
+ * Description :
+ * Give the frame returned by PROTOCOL_getFrame/PROTOCOL_waitFrame back to the parser.
+ */
+void PROTOCOL_releaseFrame(void);
+
+/*
+ * Description :
+ * Set the Call Back function called from the UART RX ISR every time a command frame is
+ * queued, it must be short (e.g. post an event) and get the frame later with PROTOCOL_getFrame.
+ */
+void PROTOCOL_setFrameCallBack(void(*a_ptr)(void));
+
+/*
+ * Description :
+ * Return the number of frames dropped because of a bad CRC, a bad length or a full queue.
+ */
+uint8 PROTOCOL_getErrorCount(void);
+
+#endif /* PROTOCOL_H_ */
@@ -0,0 +1,147 @@
+ /******************************************************************************
+ *
+ * Module: Scheduler
+ *
+ * File Name: scheduler.c
+ *
+ * Description: Source file for the cooperative run-to-completion event scheduler
+ *
+ * Author: Belal Badr
+ *
+ *******************************************************************************/
+#include "scheduler.h"
+#include <avr/io.h> /* To use the SREG Register */
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+typedef struct
+{
+	uint8 event;
+	uint8 param;
+}SCHEDULER_EventType;
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/*
+ * Events queue.
+ * It has many producers (ISRs & handlers) so the head is moved under a critical section,
+ * the main loop is the only consumer so the tail is moved without one.
+ */
+static volatile SCHEDULER_EventType g_queue[SCHEDULER_QUEUE_SIZE];
+static volatile uint8 g_queueHead = 0;
+static volatile uint8 g_queueTail = 0;
+
+static volatile uint8 g_overflowCount = 0;
+
+static SCHEDULER_HandlerType g_handlers[SCHEDULER_MAX_EVENTS];
+
+/* Called by the main loop when there is no event to dispatch */
+static void (*g_idleCallBackPtr)(void) = NULL_PTR;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+void SCHEDULER_init(void)
+{
+	uint8 i;
+
+	g_queueHead = 0;
+	g_queueTail = 0;
+	g_overflowCount = 0;
+
+	for(i=0; i<SCHEDULER_MAX_EVENTS; i++)
+	{
+		g_handlers[i] = NULL_PTR;
+	}
+}
+
+void SCHEDULER_setHandler(uint8 event, SCHEDULER_HandlerType handler)
+{
+	if(event < SCHEDULER_MAX_EVENTS)
+	{
+		g_handlers[event] = handler;
+	}
+}
+
+boolean SCHEDULER_postEvent(uint8 event, uint8 param)
+{
+	boolean posted = FALSE;
+	uint8 next_head;
+	uint8 sreg = SREG;
+
+	SREG &= ~(1<<7);
+
+	next_head = (g_queueHead + 1) & SCHEDULER_QUEUE_MASK;
+	if(next_head == g_queueTail)
+	{
+		/* Queue is full, drop the event */
+		g_overflowCount++;
+	}
+	else
+	{
+		g_queue[g_queueHead].event = event;
+		g_queue[g_queueHead].param = param;
+		g_queueHead = next_head;
+		posted = TRUE;
+	}
+
+	SREG = sreg;
+
+	return posted;
+}
+
+boolean SCHEDULER_dispatch(void)
+{
+	uint8 event;
+	uint8 param;
+
+	if(g_queueTail == g_queueHead)
+	{
+		return FALSE;
+	}
+
+	event = g_queue[g_queueTail].event;
+	param = g_queue[g_queueTail].param;
+	g_queueTail = (g_queueTail + 1) & SCHEDULER_QUEUE_MASK;
+
+	/* Run the handler to completion, events without a handler are dropped */
+	if((event < SCHEDULER_MAX_EVENTS) && (g_handlers[event] != NULL_PTR))
+	{
+		(*g_handlers[event])(param);
+	}
+
+	return TRUE;
+}
+
+void SCHEDULER_run(void)
+{
+	while(1)
+	{
+		if((SCHEDULER_dispatch() == FALSE) && (g_idleCallBackPtr != NULL_PTR))
+		{
+			/* Check the queue again with the interrupts disabled, so an event posted by an ISR
+			   after the dispatch wakes the idle call back up instead of waiting for it */
+			SREG &= ~(1<<7);
+			if(g_queueTail == g_queueHead)
+			{
+				(*g_idleCallBackPtr)();
+			}
+			SREG |= (1<<7);
+		}
+	}
+}
+
+void SCHEDULER_setIdleCallBack(void(*a_ptr)(void))
+{
+	/* Save the address of the Call back function in a global variable */
+	g_idleCallBackPtr = a_ptr;
+}
+
+uint8 SCHEDULER_getOverflowCount(void)
+{
+	return g_overflowCount;
+}
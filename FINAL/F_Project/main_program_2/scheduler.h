@@ -0,0 +1,91 @@
+ /******************************************************************************
+ *
+ * Module: Scheduler
+ *
+ * File Name: scheduler.h
+ *
+ * Description: Header file for the cooperative run-to-completion event scheduler
+ *
+ * Author: Belal Badr
+ *
+ *******************************************************************************/
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Number of events that can wait in the queue, must be a power of 2 */
+#define SCHEDULER_QUEUE_SIZE          16
+#define SCHEDULER_QUEUE_MASK          (SCHEDULER_QUEUE_SIZE - 1)
+
+/* Number of event ids (0 .. SCHEDULER_MAX_EVENTS-1) that can have a handler */
+#define SCHEDULER_MAX_EVENTS          16
+
+#if ((SCHEDULER_QUEUE_SIZE & SCHEDULER_QUEUE_MASK) != 0)
+#error "SCHEDULER_QUEUE_SIZE must be a power of 2"
+#endif
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Event handler, it is called from the main loop with the parameter posted with the event */
+typedef void (*SCHEDULER_HandlerType)(uint8 param);
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Empty the events queue and remove all the handlers.
+ */
+void SCHEDULER_init(void);
+
+/*
+ * Description :
+ * Set the handler that runs to completion every time the event is dispatched.
+ */
+void SCHEDULER_setHandler(uint8 event, SCHEDULER_HandlerType handler);
+
+/*
+ * Description :
+ * Queue an event with its parameter, it can be called from the ISRs and from the handlers.
+ * Returns FALSE if the queue is full and the event is dropped.
+ */
+boolean SCHEDULER_postEvent(uint8 event, uint8 param);
+
+/*
+ * Description :
+ * Run the handler of the oldest queued event.
+ * Returns FALSE if there was no event to dispatch.
+ */
+boolean SCHEDULER_dispatch(void);
+
+/*
+ * Description :
+ * The main loop, it dispatches the events forever and calls the idle Call Back whenever the
+ * queue is empty.
+ */
+void SCHEDULER_run(void);
+
+/*
+ * Description :
+ * Set the Call Back function called by SCHEDULER_run when there is no event to dispatch (e.g.
+ * to sleep until the next interrupt). It is called with the interrupts disabled and must
+ * enable them, the interrupts are enabled again when it returns.
+ */
+void SCHEDULER_setIdleCallBack(void(*a_ptr)(void));
+
+/*
+ * Description :
+ * Return the number of events dropped because the queue was full.
+ */
+uint8 SCHEDULER_getOverflowCount(void);
+
+#endif /* SCHEDULER_H_ */
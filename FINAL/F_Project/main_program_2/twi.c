@@ -27,14 +27,14 @@ void TWI_init(const Twi_ConfigType * Config_Ptr)
 {
 	if(Config_Ptr->Bit_Rate == Normal_mode)
 	{
-		/* Bit Rate: 100.000 kbps using zero pre-scaler TWPS=00 and F_CPU=8Mhz */
-		TWBR = 0x02;
-	    TWSR = 0x02;
+		/* Bit Rate: up to 100.000 kbps using zero pre-scaler TWPS=00, TWBR computed from F_CPU */
+		TWBR = (uint8)TWI_NORMAL_MODE_TWBR;
+	    TWSR = 0x00;
 	}
 	else if(Config_Ptr->Bit_Rate == Fast_mode)
 	{
-		/* Bit Rate: 400.000 kbps using zero pre-scaler TWPS=00 and F_CPU=8Mhz */
-		TWBR = 0x02;
+		/* Bit Rate: up to 400.000 kbps using zero pre-scaler TWPS=00, TWBR computed from F_CPU */
+		TWBR = (uint8)TWI_FAST_MODE_TWBR;
 	    TWSR = 0x00;
 	}
 
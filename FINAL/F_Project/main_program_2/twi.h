@@ -30,6 +30,31 @@ typedef struct
  *                      Preprocessor Macros                                    *
  *******************************************************************************/
 
+/*
+ * Bit rate configuration.
+ * SCL = F_CPU / (16 + 2 * TWBR * 4^TWPS), the TWBR values are derived from F_CPU at compile
+ * time with TWPS = 0 and rounded up so SCL never goes above the required rate. The datasheet
+ * requires TWBR >= 10 in master mode, so at low F_CPU the bus runs slower than required,
+ * which is always safe for I2C (1 MHz: about 27.7 kHz in both modes).
+ */
+#ifndef F_CPU
+#error "F_CPU must be defined"
+#endif
+
+#define TWI_NORMAL_MODE_SCL   100000UL
+#define TWI_FAST_MODE_SCL     400000UL
+#define TWI_MIN_TWBR          10UL
+
+#define TWI_TWBR_VALUE(scl)   (((F_CPU / (scl)) > (16UL + (2UL * TWI_MIN_TWBR))) ? \
+                               (((F_CPU / (scl)) - 16UL + 1UL) / 2UL) : TWI_MIN_TWBR)
+
+#define TWI_NORMAL_MODE_TWBR  TWI_TWBR_VALUE(TWI_NORMAL_MODE_SCL)
+#define TWI_FAST_MODE_TWBR    TWI_TWBR_VALUE(TWI_FAST_MODE_SCL)
+
+#if (TWI_NORMAL_MODE_TWBR > 255UL) || (TWI_FAST_MODE_TWBR > 255UL)
+#error "TWI bit rate is too low for this F_CPU"
+#endif
+
 /* I2C Status Bits in the TWSR Register */
 #define TWI_START         0x08 /* start has been sent */
 #define TWI_REP_START     0x10 /* repeated start */
@@ -14,7 +14,9 @@
 #define UART_H_
 
 #include "std_types.h"
-
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
 
 typedef enum
 {
@@ -33,13 +35,48 @@ typedef enum
 
 typedef struct
 {
-	uint32 Baud_Rate;
 	Uart_BitsNumber Bits_Number;
 	Uart_Parity Parity ;
 	Uart_StopBitsNumber Stop_Bits_Number;
 
 }UART_ConfigType;
 
+/*
+ * Baud rate configuration.
+ * The UBRR value is derived from F_CPU at compile time (U2X = 1 so the baud rate is
+ * F_CPU / (8 * (UBRR + 1))) and rounded to the nearest value.
+ */
+#ifndef F_CPU
+#error "F_CPU must be defined"
+#endif
+
+#define UART_BAUD_RATE             9600UL
+
+/* Maximum accepted baud rate error in per mille */
+#define UART_BAUD_RATE_MAX_ERROR   20UL
+
+#define UART_UBRR_VALUE            (((F_CPU + (4UL * UART_BAUD_RATE)) / (8UL * UART_BAUD_RATE)) - 1UL)
+#define UART_ACTUAL_BAUD_RATE      (F_CPU / (8UL * (UART_UBRR_VALUE + 1UL)))
+
+#if (UART_UBRR_VALUE > 4095UL)
+#error "UART_BAUD_RATE is too low for this F_CPU"
+#endif
+
+#if ((((UART_ACTUAL_BAUD_RATE > UART_BAUD_RATE) ? (UART_ACTUAL_BAUD_RATE - UART_BAUD_RATE) : (UART_BAUD_RATE - UART_ACTUAL_BAUD_RATE)) * 1000UL) > (UART_BAUD_RATE_MAX_ERROR * UART_BAUD_RATE))
+#error "UART_BAUD_RATE error is above UART_BAUD_RATE_MAX_ERROR for this F_CPU"
+#endif
+
+/* Ring buffers sizes, must be a power of 2 (one slot is always kept empty) */
+#define UART_RX_BUFFER_SIZE        32
+#define UART_TX_BUFFER_SIZE        32
+
+#define UART_RX_BUFFER_MASK        (UART_RX_BUFFER_SIZE - 1)
+#define UART_TX_BUFFER_MASK        (UART_TX_BUFFER_SIZE - 1)
+
+#if ((UART_RX_BUFFER_SIZE & UART_RX_BUFFER_MASK) != 0) || ((UART_TX_BUFFER_SIZE & UART_TX_BUFFER_MASK) != 0)
+#error "UART buffer sizes must be a power of 2"
+#endif
+
 
 /*******************************************************************************
  *                      Functions Prototypes                                   *
@@ -49,20 +86,56 @@ typedef struct
  * Description :
  * Functional responsible for Initialize the UART device by:
  * 1. Setup the Frame format like number of data bits, parity bit type and number of stop bits.
- * 2. Enable the UART.
- * 3. Setup the UART baud rate.
+ * 2. Enable the UART and its RX Complete interrupt.
+ * 3. Setup the UART baud rate (UART_BAUD_RATE) from the compile time UBRR value.
+ * The ring buffers are served by the ISRs once the application enables the I-bit.
  */
 void UART_init(const UART_ConfigType * Config_Ptr);
 
+/*
+ * Description :
+ * Queue up to "length" bytes for transmission without blocking.
+ * Returns the number of bytes queued, which is less than "length" if the TX buffer is full.
+ */
+uint8 UART_write(const uint8 *data, uint8 length);
+
+/*
+ * Description :
+ * Copy up to "length" received bytes into "data" without blocking.
+ * Returns the number of bytes copied, zero if nothing has been received.
+ */
+uint8 UART_read(uint8 *data, uint8 length);
+
+/*
+ * Description :
+ * Return the number of received bytes waiting in the RX buffer.
+ */
+uint8 UART_available(void);
+
+/*
+ * Description :
+ * Return the number of received bytes dropped since UART_init because the RX buffer was full.
+ */
+uint8 UART_getOverflowCount(void);
+
+/*
+ * Description :
+ * Set the function to be called from the RX Complete ISR with every received byte.
+ * While it is set the RX buffer is bypassed, pass NULL_PTR to return to the RX buffer.
+ */
+void UART_setRxCallBack(void(*a_ptr)(uint8 data));
+
 /*
  * Description :
  * Functional responsible for send byte to another UART device.
+ * Blocking wrapper over UART_write, it waits only while the TX buffer is full.
  */
 void UART_sendByte(const uint8 data);
 
 /*
  * Description :
  * Functional responsible for receive byte from another UART device.
+ * Blocking wrapper over UART_read, it waits until a byte is received.
  */
 uint8 UART_recieveByte(void);
 